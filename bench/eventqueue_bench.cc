@@ -0,0 +1,56 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+// Microbenchmarks of the future event sets of the headless engine, on the "hold" model:
+// the queue holds the events of a full window, three per frame (processing, arrival and
+// timeout), and every event handled schedules another a processing time, a transmission
+// delay or a timeout later, as in a run with the defaults of package.ned.
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "eventqueue.h"
+
+static void WindowSizes(benchmark::internal::Benchmark* b) {
+    for (int window : {8, 64, 512, 4096, 65536}) b->Arg(window);
+}
+
+template<typename Queue> static void BM_Hold(benchmark::State& state) {
+    static const double delays[] = {0.5, 1.0, 10.0};
+    const int window = state.range(0);
+    std::vector<Event> events(3 * window);
+    std::mt19937 rng(1);
+    uint64_t order = 0;
+
+    // Frames in flight are spread over the timeout, their processing over the window.
+    Queue queue;
+    for (Event &e : events) {
+        e.time = delays[order % 3] * (rng() % 1000) / 1000.0;
+        e.order = order++;
+        queue.push(&e);
+    }
+
+    for (auto _ : state) {
+        Event* e = queue.pop();
+        e->time += delays[rng() % 3];
+        e->order = order++;
+        queue.push(e);
+    }
+    state.counters["events/s"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK_TEMPLATE(BM_Hold, EventHeap)->Apply(WindowSizes);
+BENCHMARK_TEMPLATE(BM_Hold, CalendarQueue)->Apply(WindowSizes);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,238 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+// Microbenchmarks of the util.cc primitives, built without the simulation kernel.
+// Payload sizes are in characters, window sizes in lines.
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "util.h"
+
+// Random printable text, with the special framing characters sprinkled in.
+static std::string MakePayload(int length, unsigned seed = 1) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ,.()$/";
+    std::mt19937 rng(seed);
+    std::string s(length, ' ');
+    for (char &c : s) c = alphabet[rng() % (sizeof(alphabet) - 1)];
+    return s;
+}
+
+// An input file of `lines` lines in the `xxxx payload` format of the input files.
+static std::string MakeInputFile(int lines, int payloadLength) {
+    std::string fileName = "bench_input_" + std::to_string(lines) + "_" + std::to_string(payloadLength) + ".txt";
+    FILE* f = fopen(fileName.c_str(), "w");
+    for (int i = 0; i < lines; i++) {
+        fprintf(f, "%d%d%d%d %s\n", (i >> 3) & 1, (i >> 2) & 1, (i >> 1) & 1, i & 1,
+                MakePayload(payloadLength, i).c_str());
+    }
+    fclose(f);
+    return fileName;
+}
+
+static void PayloadSizes(benchmark::internal::Benchmark* b) {
+    for (int size : {16, 64, 256, 1024, 4096}) b->Arg(size);
+}
+
+static void WindowSizes(benchmark::internal::Benchmark* b) {
+    for (int window : {8, 64, 512, 4096}) b->Arg(window);
+}
+
+//
+// Conversions
+//
+
+static void BM_ConvertStringToBits(benchmark::State& state, bool frame) {
+    std::string payload = MakePayload(state.range(0));
+    for (auto _ : state) benchmark::DoNotOptimize(ConvertStringToBits(payload, frame));
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK_CAPTURE(BM_ConvertStringToBits, plain, false)->Apply(PayloadSizes);
+BENCHMARK_CAPTURE(BM_ConvertStringToBits, framed, true)->Apply(PayloadSizes);
+
+static void BM_ConvertStringToBitsReused(benchmark::State& state) {
+    std::string payload = MakePayload(state.range(0));
+    vecBitset8 bytes;
+    for (auto _ : state) {
+        ConvertStringToBits(payload.data(), payload.size(), bytes, true);
+        benchmark::DoNotOptimize(bytes.data());
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_ConvertStringToBitsReused)->Apply(PayloadSizes);
+
+static void BM_ConvertBitsToString(benchmark::State& state, bool deframe) {
+    std::string payload = MakePayload(state.range(0));
+    vecBitset8 bytes = ConvertStringToBits(payload, deframe);
+    for (auto _ : state) benchmark::DoNotOptimize(ConvertBitsToString(bytes, deframe));
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK_CAPTURE(BM_ConvertBitsToString, plain, false)->Apply(PayloadSizes);
+BENCHMARK_CAPTURE(BM_ConvertBitsToString, deframed, true)->Apply(PayloadSizes);
+
+//
+// Checksums
+//
+
+static void BM_CalculateChecksum(benchmark::State& state) {
+    vecBitset8 bytes = ConvertStringToBits(MakePayload(state.range(0)), true);
+    for (auto _ : state) benchmark::DoNotOptimize(CalculateChecksum(bytes));
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_CalculateChecksum)->Apply(PayloadSizes);
+
+static void BM_VerifyChecksum(benchmark::State& state) {
+    vecBitset8 bytes = ConvertStringToBits(MakePayload(state.range(0)), true);
+    bitset8 checksum = CalculateChecksum(bytes);
+    for (auto _ : state) benchmark::DoNotOptimize(VerifyChecksum(bytes, checksum));
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_VerifyChecksum)->Apply(PayloadSizes);
+
+//
+// TextFile
+//
+
+static void BM_OpenFile(benchmark::State& state) {
+    std::string fileName = MakeInputFile(state.range(0), 64);
+    for (auto _ : state) {
+        TextFile file(fileName);
+        file.OpenFile();
+        benchmark::DoNotOptimize(file.lineBeginnings.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    remove(fileName.c_str());
+}
+BENCHMARK(BM_OpenFile)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Reading every line once, in order, with a window-sized buffer.
+static void BM_ReadNthLineSequential(benchmark::State& state) {
+    const int lines = 20000;
+    std::string fileName = MakeInputFile(lines, 64);
+    TextFile file(fileName);
+    file.OpenFile();
+    file.SetBufferSize(state.range(0));
+    std::string line;
+    int n = 0;
+    for (auto _ : state) {
+        file.ReadNthLine(n, line);
+        benchmark::DoNotOptimize(line.data());
+        n = (n + 1) % lines;
+    }
+    state.SetItemsProcessed(state.iterations());
+    remove(fileName.c_str());
+}
+BENCHMARK(BM_ReadNthLineSequential)->Apply(WindowSizes);
+
+// The Go-Back-N pattern: a window of new lines is read from disk, then rewound and
+// read again from the buffer, as on a timeout.
+static void BM_ReadNthLineRewind(benchmark::State& state) {
+    const int window = state.range(0);
+    const int lines = std::max(20000, 4 * window);
+    std::string fileName = MakeInputFile(lines, 64);
+    TextFile file(fileName);
+    file.OpenFile();
+    file.SetBufferSize(window);
+    std::string line;
+    int offset = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < window; i++) file.ReadNthLine(offset + i, line);
+        for (int i = 0; i < window; i++) file.ReadNthLine(offset + i, line);
+        benchmark::DoNotOptimize(line.data());
+        offset = (offset + window) % (lines - window);
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * window);
+    remove(fileName.c_str());
+}
+BENCHMARK(BM_ReadNthLineRewind)->Apply(WindowSizes);
+
+// The same pattern through the batched reader.
+static void BM_ReadLinesRewind(benchmark::State& state) {
+    const int window = state.range(0);
+    const int lines = std::max(20000, 4 * window);
+    std::string fileName = MakeInputFile(lines, 64);
+    TextFile file(fileName);
+    file.OpenFile();
+    file.SetBufferSize(window);
+    std::vector<std::string> batch;
+    std::vector<bool> readFromBuffer;
+    int offset = 0;
+    for (auto _ : state) {
+        file.ReadLines(offset, window, batch, readFromBuffer);
+        file.ReadLines(offset, window, batch, readFromBuffer);
+        benchmark::DoNotOptimize(batch.data());
+        offset = (offset + window) % (lines - window);
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * window);
+    remove(fileName.c_str());
+}
+BENCHMARK(BM_ReadLinesRewind)->Apply(WindowSizes);
+
+//
+// Linked lists
+//
+
+// Inserting into a full size-constrained list, which evicts the oldest element.
+static void BM_LinkedListInsert(benchmark::State& state) {
+    linkedList<TextLine> l;
+    l.size = l.availSpace = state.range(0);
+    int n = 0;
+    for (auto _ : state) {
+        InsertAtEndOfLinkedList<TextLine, int>(&l);
+        l.end->N = n++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    while (l.start) DeleteElementFromLinkedList<TextLine, int>(&l, l.start->N);
+}
+BENCHMARK(BM_LinkedListInsert)->Apply(WindowSizes);
+
+// Looking up every element of a window-sized list.
+static void BM_LinkedListLookup(benchmark::State& state) {
+    const int window = state.range(0);
+    linkedList<TextLine> l;
+    for (int i = 0; i < window; i++) {
+        InsertAtEndOfLinkedList<TextLine, int>(&l);
+        l.end->N = i;
+    }
+    int n = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(GetElementFromLinkedList<TextLine, int>(&l, n));
+        n = (n + 1) % window;
+    }
+    state.SetItemsProcessed(state.iterations());
+    while (l.start) DeleteElementFromLinkedList<TextLine, int>(&l, l.start->N);
+}
+BENCHMARK(BM_LinkedListLookup)->Apply(WindowSizes);
+
+// Deleting from the front of the list, as acknowledged lines of the input buffer are.
+static void BM_LinkedListDeleteFront(benchmark::State& state) {
+    const int window = state.range(0);
+    linkedList<TextLine> l;
+    int n = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (int i = 0; i < window; i++) {
+            InsertAtEndOfLinkedList<TextLine, int>(&l);
+            l.end->N = n++;
+        }
+        state.ResumeTiming();
+        while (l.start) DeleteElementFromLinkedList<TextLine, int>(&l, l.start->N);
+    }
+    state.SetItemsProcessed(state.iterations() * window);
+}
+BENCHMARK(BM_LinkedListDeleteFront)->Apply(WindowSizes);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,334 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "engine.h"
+#include "protocolcore.h"
+
+//
+// HeadlessNode
+//
+
+double HeadlessNode::getTime() {
+    return simulation->now;
+}
+
+void HeadlessNode::schedule(double time, Frame* frame) {
+    simulation->post(time, frame, index, true);
+}
+
+void HeadlessNode::cancel(Frame* frame) {
+    if (frame->handle) ((Event*)frame->handle)->frame = NULL;
+    delete frame;
+}
+
+void HeadlessNode::sendToPeer(Frame* frame, double delay) {
+    simulation->post(simulation->now + delay, frame, 1 - index, false);
+}
+
+double HeadlessNode::uniformRandom(double a, double b, int rng) {
+    // 53 random bits, as a double in [0, 1).
+    double u = (simulation->rng(rng)() >> 11) * (1.0 / 9007199254740992.0);
+    return a + (b - a) * u;
+}
+
+int HeadlessNode::intuniformRandom(int a, int b, int rng) {
+    return a + (int)(uniformRandom(0, 1, rng) * ((double)b - a + 1));
+}
+
+bool HeadlessNode::isLogEnabled() const {
+    return simulation->log != NULL;
+}
+
+void HeadlessNode::writeLog(const char* line, size_t length) {
+    simulation->log->write(line, length).put('\n');
+}
+
+void HeadlessNode::recordResult(const char* name, double value) {
+    results.push_back(std::make_pair(std::string(name), value));
+}
+
+void HeadlessNode::endRun() {
+    simulation->stopped = true;
+}
+
+//
+// HeadlessSimulation
+//
+
+HeadlessSimulation::HeadlessSimulation(const LinkConfig &config, const std::string inputFiles[2], std::ostream* log, uint64_t seed)
+    : events(new EventHeap()), log(log), seed(seed)
+{
+    for (int i = 0; i < 2; i++) {
+        nodes[i].input = new TextFile(inputFiles[i]);
+        if (!config.deliveryOutput.empty()) nodes[i].peerInput = new TextFile(inputFiles[1 - i]);
+    }
+    createNodes(config);
+}
+
+HeadlessSimulation::HeadlessSimulation(const LinkConfig &config, const std::shared_ptr<const MappedInput> inputs[2],
+        std::ostream* log, uint64_t seed)
+    : events(new EventHeap()), log(log), seed(seed)
+{
+    for (int i = 0; i < 2; i++) {
+        nodes[i].input = new TextFile(inputs[i]);
+        if (!config.deliveryOutput.empty()) nodes[i].peerInput = new TextFile(inputs[1 - i]);
+    }
+    createNodes(config);
+}
+
+void HeadlessSimulation::createNodes(const LinkConfig &config) {
+    this->config = config;
+    for (int i = 0; i < 2; i++) {
+        nodes[i].simulation = this;
+        nodes[i].index = i;
+        nodes[i].protocol = CreateProtocol(i, config, &nodes[i], nodes[i].input);
+        nodes[i].protocol->setDeliveryReference(nodes[i].peerInput);
+    }
+}
+
+HeadlessSimulation::~HeadlessSimulation() {
+    while (!events->empty()) {
+        Event* e = events->pop();
+        delete e->frame;
+        delete e;
+    }
+    for (Event* e : freeEvents) delete e;
+
+    for (int i = 0; i < 2; i++) {
+        delete nodes[i].protocol;
+        delete nodes[i].input;
+        delete nodes[i].peerInput;
+    }
+}
+
+std::mt19937_64& HeadlessSimulation::rng(int k) {
+    while ((int)rngs.size() <= k) {
+        std::seed_seq seeds{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)rngs.size()};
+        rngs.emplace_back(seeds);
+    }
+    return rngs[k];
+}
+
+Event* HeadlessSimulation::newEvent() {
+    if (freeEvents.empty()) return new Event();
+    Event* e = freeEvents.back();
+    freeEvents.pop_back();
+    return e;
+}
+
+void HeadlessSimulation::post(double time, Frame* frame, int node, bool self) {
+    Event* e = newEvent();
+    e->time = time;
+    e->order = nextOrder++;
+    e->frame = frame;
+    e->node = node;
+    e->self = self;
+    if (self) frame->handle = e;
+    events->push(e);
+}
+
+void HeadlessSimulation::run(int startingNodeID, double startingTime, double timeLimit) {
+
+    // The coordinator's message reaches both nodes at time 0.
+    if (!resumed)
+        for (int i = 0; i < 2; i++) nodes[i].protocol->start(startingNodeID, startingTime);
+
+    while (!stopped) {
+        // The phase actions due by the next event go out first, even with no events left.
+        while (nextPhase < phases.size() && (events->empty() || phases[nextPhase].time <= events->top()->time))
+            postPhaseAction(phases[nextPhase++]);
+        if (events->empty()) break;
+
+        Event* e = events->pop();
+        Frame* frame = e->frame;
+        if (frame) {
+            if (timeLimit > 0 && e->time > timeLimit) {
+                events->push(e);
+                break;
+            }
+            while (telemetryInterval > 0 && nextTelemetry <= e->time) {
+                writeTelemetry(nextTelemetry);
+                nextTelemetry += telemetryInterval;
+            }
+            now = e->time;
+            eventCount++;
+            frame->handle = NULL;
+            nodes[e->node].protocol->handleFrame(frame, e->self);
+        }
+        freeEvents.push_back(e);
+
+        if (frame && checkpointInterval && eventCount % checkpointInterval == 0 && !stopped)
+            writeCheckpointFile();
+    }
+
+    if (telemetry.isOpen()) writeTelemetry(now);
+    for (int i = 0; i < 2; i++) nodes[i].protocol->finish();
+    if (log) log->flush();
+}
+
+void HeadlessSimulation::setEventQueue(const std::string &kind) {
+    if (!events->empty()) throw std::runtime_error("The event queue can only change before the run.");
+    events = CreateEventQueue(kind);
+}
+
+void HeadlessSimulation::setPhases(const std::vector<PhaseAction> &phases) {
+    this->phases = phases;
+    nextPhase = 0;
+}
+
+void HeadlessSimulation::postPhaseAction(const PhaseAction &action) {
+    for (int i = 0; i < 2; i++) {
+        if (action.node != -1 && action.node != i) continue;
+        Frame* frame = new Frame();
+        frame->frameType = CONTROL_FRAME;
+        frame->payload = ConvertStringToBits(action.command());
+        post(action.time, frame, i, false);
+    }
+}
+
+void HeadlessSimulation::setTelemetry(const std::string &file, double interval) {
+    telemetry.open(file);
+    telemetryInterval = interval;
+    nextTelemetry = (std::floor(now / interval) + 1) * interval;
+}
+
+void HeadlessSimulation::writeTelemetry(double time) {
+    const Protocol* protocols[2] = {nodes[0].protocol, nodes[1].protocol};
+    telemetry.write(time, eventCount, protocols);
+}
+
+void HeadlessSimulation::setCheckpointing(const std::string &file, uint64_t interval) {
+    checkpointFile = file;
+    checkpointInterval = interval;
+}
+
+// Writes the checkpoint next to the last one and then replaces it, so that a run
+// killed while writing still leaves a complete checkpoint behind.
+void HeadlessSimulation::writeCheckpointFile() {
+    std::string temporary = checkpointFile + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        saveCheckpoint(out);
+        if (!out.good()) throw std::runtime_error("Error writing checkpoint " + temporary);
+    }
+    if (std::rename(temporary.c_str(), checkpointFile.c_str()) != 0) {
+        std::remove(checkpointFile.c_str());
+        if (std::rename(temporary.c_str(), checkpointFile.c_str()) != 0)
+            throw std::runtime_error("Error replacing checkpoint " + checkpointFile);
+    }
+}
+
+void HeadlessSimulation::saveCheckpoint(std::ostream &out) {
+    CheckpointWriter writer(out);
+    writer.write<uint64_t>(CHECKPOINT_MAGIC);
+    writer.write<uint32_t>(CHECKPOINT_VERSION);
+    writer.write<int32_t>(config.windowSize);
+    writer.write<int64_t>(config.sequenceSpace);
+
+    writer.write<double>(now);
+    writer.write<uint64_t>(nextOrder);
+    writer.write<uint64_t>(eventCount);
+    writer.write<uint64_t>(nextPhase);
+    writer.write<uint64_t>(seed);
+    writer.write<uint32_t>(rngs.size());
+    for (std::mt19937_64 &r : rngs) {
+        std::ostringstream state;
+        state << r;
+        writer.writeString(state.str());
+    }
+
+    int64_t logOffset = -1;
+    if (log) {
+        log->flush();
+        logOffset = (int64_t)log->tellp();
+    }
+    writer.write<int64_t>(logOffset);
+
+    // The pending events, in no particular order; the insertion order keeps them sorted.
+    std::vector<Event*> pending;
+    while (!events->empty()) pending.push_back(events->pop());
+    uint32_t count = 0;
+    for (Event* e : pending) if (e->frame) count++;
+    writer.write<uint32_t>(count);
+    for (Event* e : pending) {
+        if (e->frame) {
+            writer.write<double>(e->time);
+            writer.write<uint64_t>(e->order);
+            writer.write<int32_t>(e->node);
+            writer.write<uint8_t>(e->self);
+            writer.addFrame(e->frame);
+        }
+        events->push(e);
+    }
+
+    for (int i = 0; i < 2; i++) nodes[i].protocol->save(writer);
+}
+
+void HeadlessSimulation::loadCheckpoint(std::istream &in) {
+    CheckpointReader reader(in);
+    if (reader.read<uint64_t>() != CHECKPOINT_MAGIC || reader.read<uint32_t>() != CHECKPOINT_VERSION)
+        throw std::runtime_error("Not a checkpoint of this version.");
+    if (reader.read<int32_t>() != config.windowSize || reader.read<int64_t>() != config.sequenceSpace)
+        throw std::runtime_error("The checkpoint was written with another window size or sequence space.");
+
+    now = reader.read<double>();
+    nextOrder = reader.read<uint64_t>();
+    eventCount = reader.read<uint64_t>();
+    nextPhase = reader.read<uint64_t>();
+    if (nextPhase > phases.size())
+        throw std::runtime_error("The checkpoint was written with a longer phase script.");
+    seed = reader.read<uint64_t>();
+    rngs.resize(reader.read<uint32_t>());
+    for (std::mt19937_64 &r : rngs) {
+        std::istringstream state(reader.readString());
+        if (!(state >> r)) throw std::runtime_error("Bad random generator state in checkpoint.");
+    }
+
+    int64_t logOffset = reader.read<int64_t>();
+    if (log && logOffset >= 0) {
+        log->seekp(0, std::ios::end);
+        if ((int64_t)log->tellp() < logOffset)
+            throw std::runtime_error("The log is shorter than when the checkpoint was written.");
+        log->seekp(logOffset);
+        resumedLogOffset = logOffset;
+    }
+
+    for (uint32_t count = reader.read<uint32_t>(); count; count--) {
+        double time = reader.read<double>();
+        uint64_t order = reader.read<uint64_t>();
+        int node = reader.read<int32_t>();
+        bool self = reader.read<uint8_t>();
+        if (node < 0 || node > 1) throw std::runtime_error("Bad event in checkpoint.");
+
+        Event* e = newEvent();
+        e->time = time;
+        e->order = order;
+        e->frame = reader.addFrame();
+        e->node = node;
+        e->self = self;
+        if (self) e->frame->handle = e;
+        events->push(e);
+    }
+
+    for (int i = 0; i < 2; i++) nodes[i].protocol->load(reader);
+    resumed = true;
+}
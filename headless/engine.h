@@ -0,0 +1,163 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef HEADLESS_ENGINE_H_
+#define HEADLESS_ENGINE_H_
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "protocol.h"
+#include "telemetry.h"
+#include "phases.h"
+#include "eventqueue.h"
+
+class HeadlessSimulation;
+
+// The Scheduler of one node under the headless engine.
+class HeadlessNode : public Scheduler {
+public:
+    HeadlessSimulation* simulation = NULL;
+    int index = 0;
+    TextFile* input = NULL;
+    Protocol* protocol = NULL;
+
+    // The peer's input, which delivered data is checked against, if delivery is on.
+    TextFile* peerInput = NULL;
+
+    // End-of-run statistics recorded by the protocol.
+    std::vector<std::pair<std::string, double> > results;
+
+    virtual double getTime() override;
+    virtual void schedule(double time, Frame* frame) override;
+    virtual void cancel(Frame* frame) override;
+    virtual void sendToPeer(Frame* frame, double delay) override;
+    virtual double uniformRandom(double a, double b, int rng = 0) override;
+    virtual int intuniformRandom(int a, int b, int rng = 0) override;
+    virtual bool isLogEnabled() const override;
+    virtual void writeLog(const char* line, size_t length) override;
+    virtual void recordResult(const char* name, double value) override;
+    virtual void endRun() override;
+};
+
+// A minimal discrete-event engine running the two nodes of the network without OMNeT++.
+// It reproduces the OMNeT++ run: the same protocol code, event order and event log,
+// apart from the random numbers, which come from its own generators.
+class HeadlessSimulation {
+    friend class HeadlessNode;
+
+    // The future event set, a heap unless setEventQueue() chooses another.
+    std::unique_ptr<EventQueue> events;
+    std::vector<Event*> freeEvents;
+    uint64_t nextOrder = 0;
+    uint64_t eventCount = 0;
+    double now = 0;
+    bool stopped = false;
+
+    // Whether the run continues from a checkpoint rather than from the coordinator's info.
+    bool resumed = false;
+
+    // Where checkpoints are written during run(), and every how many events (0 for never).
+    std::string checkpointFile;
+    uint64_t checkpointInterval = 0;
+
+    // The configuration the run started with, which phase actions may change in the protocols.
+    LinkConfig config;
+
+    // The coordinator's phase script, and the next action to send.
+    std::vector<PhaseAction> phases;
+    size_t nextPhase = 0;
+
+    // Where telemetry is written during run(), and every how many simulated seconds (0 for never).
+    TelemetryWriter telemetry;
+    double telemetryInterval = 0;
+    double nextTelemetry = 0;
+
+    // The event log, or NULL to discard it.
+    std::ostream* log;
+
+    // One generator per RNG index, shared by the nodes as OMNeT++ module RNGs are by default.
+    // Each is seeded from the run seed and its index, so runs with different seeds draw
+    // independent streams.
+    uint64_t seed;
+    std::vector<std::mt19937_64> rngs;
+
+    // The length of the log when the loaded checkpoint was written, -1 for none.
+    int64_t resumedLogOffset = -1;
+
+    HeadlessNode nodes[2];
+
+    void createNodes(const LinkConfig &config);
+    Event* newEvent();
+    void post(double time, Frame* frame, int node, bool self);
+    void writeCheckpointFile();
+    void writeTelemetry(double time);
+    void postPhaseAction(const PhaseAction &action);
+    std::mt19937_64& rng(int k);
+public:
+    // The input files of the two nodes are opened by the sender's protocol when it starts.
+    // The configuration must be validated.
+    HeadlessSimulation(const LinkConfig &config, const std::string inputFiles[2], std::ostream* log, uint64_t seed);
+
+    // Reads the input lines from the given shared inputs instead, without opening any file.
+    // A simulation keeps no other shared state, so simulations can run on separate threads.
+    HeadlessSimulation(const LinkConfig &config, const std::shared_ptr<const MappedInput> inputs[2],
+            std::ostream* log, uint64_t seed);
+    ~HeadlessSimulation();
+
+    // Runs from the coordinator's starting info until the sender finishes, no events are
+    // left, or the time limit (if positive) passes. Records the statistics at the end.
+    void run(int startingNodeID, double startingTime, double timeLimit = 0);
+
+    // Writes the whole state of the run to `out`: the time, counters, random generators,
+    // pending events, both protocols and the offset of the log.
+    void saveCheckpoint(std::ostream &out);
+
+    // Restores a checkpoint written by saveCheckpoint() with the same window size and
+    // sequence space, before run(), which then continues from it. The log, if any, is
+    // moved back to where it was when the checkpoint was written; it must be opened
+    // for writing without truncation, and the caller cuts off what follows (see
+    // getResumedLogOffset()). Throws std::runtime_error on a bad checkpoint.
+    void loadCheckpoint(std::istream &in);
+
+    // Replaces the future event set with one of the given kind (see CreateEventQueue),
+    // before run() or loadCheckpoint(). The event log is the same with any of them.
+    void setEventQueue(const std::string &kind);
+
+    // Makes run() write a checkpoint to `file` every `interval` events, replacing the last one.
+    void setCheckpointing(const std::string &file, uint64_t interval);
+
+    // Sets the coordinator's phase script (see ReadPhaseScript), before run() or loadCheckpoint().
+    // Each action is sent to its nodes as a control frame once the run reaches its time,
+    // behind the events already due then, as the coordinator's messages are under OMNeT++.
+    void setPhases(const std::vector<PhaseAction> &phases);
+
+    // Makes run() write a line of telemetry (see TelemetryWriter) to `file` every `interval`
+    // seconds of simulated time, and once more at the end. The file is truncated now.
+    void setTelemetry(const std::string &file, double interval);
+
+    uint64_t getEventCount() const { return eventCount; }
+    int64_t getResumedLogOffset() const { return resumedLogOffset; }
+    double getTime() const { return now; }
+    bool isFinished() const { return stopped; }
+    const HeadlessNode& getNode(int i) const { return nodes[i]; }
+};
+
+#endif /* HEADLESS_ENGINE_H_ */
@@ -0,0 +1,164 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include "eventqueue.h"
+
+//
+// EventHeap
+//
+
+void EventHeap::siftUp(size_t i) {
+    Event* e = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!earlier(e, heap[parent])) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = e;
+}
+
+void EventHeap::siftDown(size_t i) {
+    Event* e = heap[i];
+    size_t n = heap.size();
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && earlier(heap[child + 1], heap[child])) child++;
+        if (!earlier(heap[child], e)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = e;
+}
+
+void EventHeap::push(Event* e) {
+    heap.push_back(e);
+    siftUp(heap.size() - 1);
+}
+
+Event* EventHeap::pop() {
+    Event* first = heap.front();
+    heap.front() = heap.back();
+    heap.pop_back();
+    if (!heap.empty()) siftDown(0);
+    return first;
+}
+
+//
+// CalendarQueue
+//
+
+void CalendarQueue::insert(Event* e) {
+    uint64_t day = dayOf(e->time);
+    Event** p = &buckets[day & mask];
+    while (*p && !earlier(e, *p)) p = &(*p)->next;
+    e->next = *p;
+    *p = e;
+
+    if (day < today) today = day;
+    if (first >= 0 && earlier(e, buckets[first])) first = -1;
+}
+
+void CalendarQueue::push(Event* e) {
+    insert(e);
+    if (++count > 2 * buckets.size()) resize(2 * buckets.size());
+}
+
+// Visits the days from today on, for at most a year. The first bucket holding an event of
+// the day it is visited on has the next event, since no event is earlier than today and
+// the buckets are sorted. When the next event is a year or more away, it is searched for
+// among the first events of all buckets instead, and the calendar jumps to its day.
+void CalendarQueue::findFirst() {
+    if (first >= 0) return;
+    for (size_t n = 0; n < buckets.size(); n++, today++) {
+        Event* head = buckets[today & mask];
+        if (head && dayOf(head->time) <= today) {
+            first = (long)(today & mask);
+            return;
+        }
+    }
+
+    Event* next = NULL;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        if (buckets[i] && (!next || earlier(buckets[i], next))) {
+            next = buckets[i];
+            first = (long)i;
+        }
+    }
+    today = dayOf(next->time);
+}
+
+Event* CalendarQueue::top() {
+    findFirst();
+    return buckets[first];
+}
+
+Event* CalendarQueue::pop() {
+    findFirst();
+    Event* e = buckets[first];
+    buckets[first] = e->next;
+    e->next = NULL;
+    first = -1;
+
+    if (--count < buckets.size() / 2 && buckets.size() > 2) resize(buckets.size() / 2);
+    return e;
+}
+
+// Rehashes the events into `bucketCount` buckets of a new width, three times the average
+// gap between the earliest events, leaving out the gaps over twice the average (Brown's
+// estimate of the spacing of the events that will be dequeued next).
+void CalendarQueue::resize(size_t bucketCount) {
+    std::vector<Event*> events;
+    events.reserve(count);
+    for (Event* head : buckets)
+        for (Event* e = head; e; e = e->next) events.push_back(e);
+
+    size_t sample = std::min<size_t>(events.size(), 25);
+    std::partial_sort(events.begin(), events.begin() + sample, events.end(), earlier);
+    if (sample > 1) {
+        // Times a rounding error apart count as simultaneous, and the width never drops to
+        // the rounding error, which would spread the events over a huge number of days.
+        double resolution = std::fabs(events[sample - 1]->time) * 1e-9;
+        double average = (events[sample - 1]->time - events[0]->time) / (sample - 1);
+        double total = 0;
+        int gaps = 0;
+        for (size_t i = 1; i < sample; i++) {
+            double gap = events[i]->time - events[i - 1]->time;
+            if (gap <= 2 * average) {
+                total += gap > resolution ? gap : 0;
+                gaps++;
+            }
+        }
+        // Simultaneous events leave the width as it was.
+        if (total > 0) width = std::max(3 * total / gaps, resolution);
+    }
+
+    buckets.assign(bucketCount, NULL);
+    mask = bucketCount - 1;
+    first = -1;
+    today = UINT64_MAX;
+    for (Event* e : events) insert(e);
+}
+
+std::unique_ptr<EventQueue> CreateEventQueue(const std::string &kind) {
+    if (kind == "heap") return std::unique_ptr<EventQueue>(new EventHeap());
+    if (kind == "calendar") return std::unique_ptr<EventQueue>(new CalendarQueue());
+    throw std::runtime_error("Unknown event queue " + kind + "; expected heap or calendar.");
+}
@@ -0,0 +1,114 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef HEADLESS_EVENTQUEUE_H_
+#define HEADLESS_EVENTQUEUE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Frame;
+
+// A frame due at a node, either scheduled by the node itself or arriving from its peer.
+struct Event {
+    double time = 0;
+
+    // Insertion order, so that simultaneous events are handled first in, first out.
+    uint64_t order = 0;
+
+    // NULL once the event is cancelled; it is then skipped when it comes up.
+    Frame* frame = NULL;
+
+    int node = 0;
+    bool self = false;
+
+    // The next event in the same bucket of a CalendarQueue.
+    Event* next = NULL;
+};
+
+// The future event set of the headless engine. Every implementation hands out the
+// events in the same order, by time and then insertion order, so the choice of one
+// changes the speed of a run and never its event log.
+class EventQueue {
+public:
+    virtual ~EventQueue() {}
+
+    virtual void push(Event* e) = 0;
+    virtual Event* pop() = 0;
+
+    // The next event pop() returns; the queue must not be empty.
+    virtual Event* top() = 0;
+
+    virtual bool empty() const = 0;
+    virtual size_t size() const = 0;
+
+    static bool earlier(const Event* a, const Event* b) {
+        return a->time < b->time || (a->time == b->time && a->order < b->order);
+    }
+};
+
+// Binary min-heap of events: O(log n) per operation, whatever the times.
+class EventHeap : public EventQueue {
+    std::vector<Event*> heap;
+
+    void siftUp(size_t i);
+    void siftDown(size_t i);
+public:
+    virtual void push(Event* e) override;
+    virtual Event* pop() override;
+    virtual Event* top() override { return heap.front(); }
+    virtual bool empty() const override { return heap.empty(); }
+    virtual size_t size() const override { return heap.size(); }
+};
+
+// Calendar queue (R. Brown, 1988): the events are hashed by time into buckets of a
+// fixed width, a "day" each, and the buckets are visited in turn like the days of
+// a year. With the width resized to a few times the average gap between the events,
+// most buckets hold one or two, so push and pop take O(1) amortized time on the
+// near-future, mostly increasing times of timers and frames in flight.
+class CalendarQueue : public EventQueue {
+    // Sorted singly linked lists of events, linked through Event::next.
+    std::vector<Event*> buckets;
+    size_t mask = 0;
+    double width = 1;
+    size_t count = 0;
+
+    // The day the calendar has reached; no event is earlier than it.
+    uint64_t today = 0;
+
+    // The bucket of the next event once found, or -1.
+    long first = -1;
+
+    uint64_t dayOf(double time) const { return (uint64_t)(time / width); }
+    void insert(Event* e);
+    void findFirst();
+    void resize(size_t bucketCount);
+public:
+    CalendarQueue() { buckets.assign(2, NULL); mask = 1; }
+
+    virtual void push(Event* e) override;
+    virtual Event* pop() override;
+    virtual Event* top() override;
+    virtual bool empty() const override { return count == 0; }
+    virtual size_t size() const override { return count; }
+};
+
+// The event queue of the given kind, "heap" or "calendar".
+// Throws std::runtime_error on another kind.
+std::unique_ptr<EventQueue> CreateEventQueue(const std::string &kind);
+
+#endif /* HEADLESS_EVENTQUEUE_H_ */
@@ -0,0 +1,166 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+// Command line front end of the headless engine. Takes the network parameters of
+// package.ned as --NAME value options, with the same defaults, for example:
+//
+//   gbn_headless --WS 3 --LP 0 --input0 src/input0.txt --input1 src/input1.txt
+//                --coordinator src/coordinator.txt --log output.txt --seed 1
+//
+// With --checkpoint file --checkpoint-every n, the state of the run is written to the
+// file every n events; --resume file continues a run from it, appending to its log.
+// With --telemetry file --telemetry-every seconds, a line of JSON with the event rate,
+// memory and live protocol state is appended to the file every so many simulated seconds.
+// --fes calendar runs on a calendar queue instead of the default binary heap (--fes heap).
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include "engine.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static void Usage() {
+    std::cerr << "usage: gbn_headless [--<NED parameter> value]... [--input0 file] [--input1 file]" << std::endl
+              << "                    [--coordinator file] [--log file|-] [--seed n] [--limit seconds]" << std::endl
+              << "                    [--checkpoint file] [--checkpoint-every events] [--resume file]" << std::endl
+              << "                    [--telemetry file] [--telemetry-every seconds] [--fes heap|calendar]" << std::endl;
+    exit(1);
+}
+
+// Cuts the file back to `length` bytes.
+static void TruncateFile(const std::string &file, int64_t length) {
+#ifdef _WIN32
+    int fd = _open(file.c_str(), _O_WRONLY | _O_BINARY);
+    bool ok = fd >= 0 && _chsize_s(fd, length) == 0;
+    if (fd >= 0) _close(fd);
+#else
+    bool ok = truncate(file.c_str(), (off_t)length) == 0;
+#endif
+    if (!ok) throw std::runtime_error("Error truncating " + file);
+}
+
+int main(int argc, char** argv) {
+
+    // The defaults are those of package.ned.
+    LinkConfig config;
+
+    std::string inputFiles[2] = {"src/input0.txt", "src/input1.txt"};
+    std::string coordinatorFile = "src/coordinator.txt";
+    std::string logFile = "output.txt";
+    uint64_t seed = 0;
+    double timeLimit = 0;
+    std::string checkpointFile, resumeFile;
+    uint64_t checkpointInterval = 0;
+    std::string telemetryFile;
+    double telemetryInterval = 0;
+    std::string eventQueue = "heap";
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc) Usage();
+        std::string name = argv[i] + 2;
+        const char* value = argv[++i];
+
+        if (name == "input0") inputFiles[0] = value;
+        else if (name == "input1") inputFiles[1] = value;
+        else if (name == "coordinator") coordinatorFile = value;
+        else if (name == "log") logFile = value;
+        else if (name == "seed") seed = strtoull(value, NULL, 10);
+        else if (name == "limit") timeLimit = atof(value);
+        else if (name == "checkpoint") checkpointFile = value;
+        else if (name == "checkpoint-every") checkpointInterval = strtoull(value, NULL, 10);
+        else if (name == "resume") resumeFile = value;
+        else if (name == "telemetry") telemetryFile = value;
+        else if (name == "telemetry-every") telemetryInterval = atof(value);
+        else if (name == "fes") eventQueue = value;
+        else if (!SetLinkParameter(config, name, value)) {
+            std::cerr << "Unknown parameter: " << name << std::endl;
+            Usage();
+        }
+    }
+
+    try {
+        config.Validate();
+
+        // Opening coordinator file and reading starting info.
+        std::ifstream coordinator(coordinatorFile);
+        int startingNodeID;
+        float startingTime;
+        if (!(coordinator >> startingNodeID >> startingTime)) {
+            std::cerr << "Error reading the coordinator file " << coordinatorFile << std::endl;
+            return 1;
+        }
+
+        // Any further lines are the phase script.
+        coordinator.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::vector<PhaseAction> phases = ReadPhaseScript(coordinator);
+
+        // "-" discards the event log.
+        std::ofstream log;
+        if (logFile != "-") {
+            // A resumed run continues the log where the checkpoint left it.
+            if (resumeFile.empty()) log.open(logFile);
+            else log.open(logFile, std::ios::in | std::ios::out);
+            if (!log.good()) throw std::runtime_error("Error opening log file.");
+        }
+
+        HeadlessSimulation simulation(config, inputFiles, logFile != "-" ? &log : NULL, seed);
+        simulation.setPhases(phases);
+        simulation.setEventQueue(eventQueue);
+
+        if (!resumeFile.empty()) {
+            std::ifstream in(resumeFile, std::ios::binary);
+            if (!in.good()) throw std::runtime_error("Error opening checkpoint " + resumeFile);
+            simulation.loadCheckpoint(in);
+
+            // What the run wrote after the checkpoint is written again, maybe shorter.
+            if (simulation.getResumedLogOffset() >= 0) {
+                log.flush();
+                TruncateFile(logFile, simulation.getResumedLogOffset());
+            }
+        }
+        if (!checkpointFile.empty() && checkpointInterval)
+            simulation.setCheckpointing(checkpointFile, checkpointInterval);
+        if (!telemetryFile.empty() && telemetryInterval > 0)
+            simulation.setTelemetry(telemetryFile, telemetryInterval);
+
+        auto begin = std::chrono::steady_clock::now();
+        simulation.run(startingNodeID, startingTime, timeLimit);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        std::cout << "simulated time: " << simulation.getTime() << " s" << std::endl
+                  << "events: " << simulation.getEventCount() << std::endl
+                  << "wall time: " << seconds << " s" << std::endl
+                  << "events/sec: " << (seconds > 0 ? simulation.getEventCount() / seconds : 0) << std::endl;
+        for (int i = 0; i < 2; i++)
+            for (auto &r : simulation.getNode(i).results)
+                std::cout << "node" << i << "." << r.first << " = " << r.second << std::endl;
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
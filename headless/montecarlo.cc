@@ -0,0 +1,255 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+// Monte Carlo runner: independent replications of the same network on a pool of
+// threads, summarized as means with 95% confidence intervals. Each replication
+// has its own engine, protocol state, random number streams (seeded from a hash of
+// --seed and the replication number, so that batches with nearby seeds do not share
+// replications) and log; only the memory-mapped input files are shared.
+// Takes the options of gbn_headless, for example:
+//
+//   gbn_montecarlo --runs 1000 --threads 8 --LP 0.1 --BER 1e-4 --seed 1
+//
+// With --logdir, the event log of replication k is written to <logdir>/run<k>.txt.
+// A delivery file (--DO path) is likewise one per replication, <path>.<k>, so that
+// the runs never write to the same file; --DO :memory: is left as it is.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include "engine.h"
+
+// The outcome of one replication.
+struct RunResult {
+    bool finished = false;
+    double simulatedTime = 0;
+    uint64_t events = 0;
+    double wallTime = 0;
+    std::vector<std::pair<std::string, double> > scalars;
+    std::string error;
+};
+
+// Mean and variance of a series of samples (Welford's method).
+struct Summary {
+    long count = 0;
+    double mean = 0;
+    double m2 = 0;
+
+    void collect(double x) {
+        count++;
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+    double stddev() const { return count > 1 ? std::sqrt(m2 / (count - 1)) : 0; }
+
+    // Half-width of the 95% confidence interval of the mean, from Student's t distribution.
+    double confidence() const {
+        static const double t[] = {
+            0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+        };
+        if (count < 2) return 0;
+        long df = count - 1;
+        double q = df < (long)(sizeof(t) / sizeof(t[0])) ? t[df] : 1.960;
+        return q * stddev() / std::sqrt((double)count);
+    }
+};
+
+static void Usage() {
+    std::cerr << "usage: gbn_montecarlo [--runs n] [--threads n] [--seed n] [--logdir dir]" << std::endl
+              << "                      [--<NED parameter> value]... [--input0 file] [--input1 file]" << std::endl
+              << "                      [--coordinator file] [--limit seconds] [--fes heap|calendar]" << std::endl;
+    exit(1);
+}
+
+// The seed of replication k of a batch, mixed from both through a seed_seq like the
+// streams of the engine; seed + k would make replication k of --seed s the
+// replication k - 1 of --seed s + 1.
+static uint64_t ReplicationSeed(uint64_t seed, int k) {
+    std::seed_seq seeds{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)k};
+    uint32_t words[2];
+    seeds.generate(words, words + 2);
+    return (uint64_t)words[1] << 32 | words[0];
+}
+
+static void RunReplication(const LinkConfig &config, const std::shared_ptr<const MappedInput> inputs[2],
+        int startingNodeID, double startingTime, const std::vector<PhaseAction> &phases, double timeLimit, uint64_t seed,
+        const std::string &eventQueue, const std::string &logFile, RunResult &result) {
+    try {
+        std::ofstream log;
+        if (!logFile.empty()) {
+            log.open(logFile);
+            if (!log.good()) throw std::runtime_error("Error opening log file " + logFile);
+        }
+
+        HeadlessSimulation simulation(config, inputs, logFile.empty() ? NULL : &log, seed);
+        simulation.setPhases(phases);
+        simulation.setEventQueue(eventQueue);
+
+        auto begin = std::chrono::steady_clock::now();
+        simulation.run(startingNodeID, startingTime, timeLimit);
+        result.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        result.finished = simulation.isFinished();
+        result.simulatedTime = simulation.getTime();
+        result.events = simulation.getEventCount();
+        for (int i = 0; i < 2; i++)
+            for (auto &r : simulation.getNode(i).results)
+                result.scalars.push_back(std::make_pair("node" + std::to_string(i) + "." + r.first, r.second));
+    }
+    catch (std::exception &e) {
+        result.error = e.what();
+    }
+}
+
+int main(int argc, char** argv) {
+
+    // The defaults are those of package.ned.
+    LinkConfig config;
+
+    std::string inputFiles[2] = {"src/input0.txt", "src/input1.txt"};
+    std::string coordinatorFile = "src/coordinator.txt";
+    std::string logDir;
+    uint64_t seed = 0;
+    double timeLimit = 0;
+    std::string eventQueue = "heap";
+    int runs = 100;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc) Usage();
+        std::string name = argv[i] + 2;
+        const char* value = argv[++i];
+
+        if (name == "input0") inputFiles[0] = value;
+        else if (name == "input1") inputFiles[1] = value;
+        else if (name == "coordinator") coordinatorFile = value;
+        else if (name == "logdir") logDir = value;
+        else if (name == "seed") seed = strtoull(value, NULL, 10);
+        else if (name == "limit") timeLimit = atof(value);
+        else if (name == "runs") runs = atoi(value);
+        else if (name == "threads") threads = atoi(value);
+        else if (name == "fes") eventQueue = value;
+        else if (!SetLinkParameter(config, name, value)) {
+            std::cerr << "Unknown parameter: " << name << std::endl;
+            Usage();
+        }
+    }
+    if (runs < 1 || threads < 1) Usage();
+    threads = std::min(threads, runs);
+
+    std::vector<RunResult> results(runs);
+    double seconds;
+    try {
+        config.Validate();
+        CreateEventQueue(eventQueue);
+
+        // Opening coordinator file and reading starting info.
+        std::ifstream coordinator(coordinatorFile);
+        int startingNodeID;
+        float startingTime;
+        if (!(coordinator >> startingNodeID >> startingTime)) {
+            std::cerr << "Error reading the coordinator file " << coordinatorFile << std::endl;
+            return 1;
+        }
+
+        // Any further lines are the phase script.
+        coordinator.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::vector<PhaseAction> phases = ReadPhaseScript(coordinator);
+
+        // The inputs are mapped and indexed once, for all the replications.
+        std::shared_ptr<const MappedInput> inputs[2] = {
+            std::make_shared<const MappedInput>(inputFiles[0]),
+            std::make_shared<const MappedInput>(inputFiles[1]),
+        };
+
+        // The replications are handed out one at a time; each writes only its own result.
+        std::atomic<int> nextRun(0);
+        auto worker = [&]() {
+            for (int k = nextRun++; k < runs; k = nextRun++) {
+                std::string logFile = logDir.empty() ? "" : logDir + "/run" + std::to_string(k) + ".txt";
+                LinkConfig runConfig = config;
+                if (!config.deliveryOutput.empty() && config.deliveryOutput != ":memory:")
+                    runConfig.deliveryOutput += "." + std::to_string(k);
+                RunReplication(runConfig, inputs, startingNodeID, startingTime, phases, timeLimit, ReplicationSeed(seed, k), eventQueue, logFile, results[k]);
+            }
+        };
+
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; t++) pool.emplace_back(worker);
+        for (std::thread &t : pool) t.join();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // Aggregating the replications, in the order the statistics were first recorded.
+    std::vector<std::string> names = {"simulatedTime", "events", "eventsPerSecond"};
+    std::map<std::string, Summary> summaries;
+    int failed = 0, unfinished = 0;
+    uint64_t totalEvents = 0;
+    for (int k = 0; k < runs; k++) {
+        const RunResult &r = results[k];
+        if (!r.error.empty()) {
+            std::cerr << "run " << k << ": " << r.error << std::endl;
+            failed++;
+            continue;
+        }
+        if (!r.finished) unfinished++;
+        totalEvents += r.events;
+
+        summaries["simulatedTime"].collect(r.simulatedTime);
+        summaries["events"].collect((double)r.events);
+        summaries["eventsPerSecond"].collect(r.wallTime > 0 ? r.events / r.wallTime : 0);
+        for (auto &s : r.scalars) {
+            if (!summaries.count(s.first)) names.push_back(s.first);
+            summaries[s.first].collect(s.second);
+        }
+    }
+
+    std::cout << "runs: " << runs << " (" << failed << " failed, " << unfinished << " unfinished)" << std::endl
+              << "threads: " << threads << std::endl
+              << "wall time: " << seconds << " s" << std::endl
+              << "events/sec: " << (seconds > 0 ? totalEvents / seconds : 0) << std::endl;
+
+    char line[256];
+    snprintf(line, sizeof(line), "%-32s %6s %14s %14s %14s", "statistic", "n", "mean", "stddev", "95% CI +/-");
+    std::cout << line << std::endl;
+    for (const std::string &name : names) {
+        const Summary &s = summaries[name];
+        if (!s.count) continue;
+        snprintf(line, sizeof(line), "%-32s %6ld %14.6g %14.6g %14.6g",
+                name.c_str(), s.count, s.mean, s.stddev(), s.confidence());
+        std::cout << line << std::endl;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,242 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+// Deterministic replay harness: runs every case of a corpus with its fixed seed and
+// compares the event log with the golden log recorded for it, reporting the first
+// event where the two diverge. The corpus has one case per line, a name followed by
+// options of gbn_headless (see replay_corpus.txt), for example:
+//
+//   gbn_replay --corpus headless/replay_corpus.txt --golden headless/golden --record
+//   gbn_replay --corpus headless/replay_corpus.txt --golden headless/golden
+//
+// --record writes <golden>/<name>.txt for every case, from a known good tree, creating the
+// directory if needed; without it, the logs are only compared and the exit status is
+// nonzero if any case differs. The golden logs of the corpus are kept in headless/golden.
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "engine.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// One case of the corpus.
+struct ReplayCase {
+    std::string name;
+    int lineNumber = 0;
+    LinkConfig config;
+    std::string inputFiles[2] = {"src/input0.txt", "src/input1.txt"};
+    std::string coordinatorFile = "src/coordinator.txt";
+    uint64_t seed = 0;
+    double timeLimit = 0;
+    std::string eventQueue = "heap";
+};
+
+// Creates the directory if it does not exist yet.
+static bool MakeDirectory(const std::string &dir) {
+#ifdef _WIN32
+    return _mkdir(dir.c_str()) == 0 || errno == EEXIST;
+#else
+    return mkdir(dir.c_str(), 0777) == 0 || errno == EEXIST;
+#endif
+}
+
+static void Usage() {
+    std::cerr << "usage: gbn_replay [--corpus file] [--golden dir] [--record] [--case name]" << std::endl;
+    exit(1);
+}
+
+// Reads the cases of the corpus, skipping blank lines and # comments.
+// Throws std::runtime_error on an unknown option or a bad configuration.
+static std::vector<ReplayCase> ReadCorpus(const std::string &file) {
+    std::ifstream in(file);
+    if (!in.good()) throw std::runtime_error("Error opening the corpus " + file);
+
+    std::vector<ReplayCase> cases;
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+        std::istringstream tokens(line.substr(0, line.find('#')));
+        ReplayCase c;
+        if (!(tokens >> c.name)) continue;
+        c.lineNumber = lineNumber;
+
+        std::string where = file + ":" + std::to_string(lineNumber) + ": ";
+        std::string option, value;
+        while (tokens >> option) {
+            if (option.compare(0, 2, "--") != 0 || !(tokens >> value))
+                throw std::runtime_error(where + "expected --option value, got " + option);
+            std::string name = option.substr(2);
+
+            if (name == "input0") c.inputFiles[0] = value;
+            else if (name == "input1") c.inputFiles[1] = value;
+            else if (name == "coordinator") c.coordinatorFile = value;
+            else if (name == "seed") c.seed = strtoull(value.c_str(), NULL, 10);
+            else if (name == "limit") c.timeLimit = atof(value.c_str());
+            else if (name == "fes") c.eventQueue = value;
+            else if (!SetLinkParameter(c.config, name, value.c_str()))
+                throw std::runtime_error(where + "unknown parameter " + name);
+        }
+        try {
+            c.config.Validate();
+            CreateEventQueue(c.eventQueue);
+        }
+        catch (std::exception &e) {
+            throw std::runtime_error(where + e.what());
+        }
+        cases.push_back(c);
+    }
+    return cases;
+}
+
+// Runs a case to the end and returns its event log.
+static std::string RunCase(const ReplayCase &c) {
+    std::ifstream coordinator(c.coordinatorFile);
+    int startingNodeID;
+    float startingTime;
+    if (!(coordinator >> startingNodeID >> startingTime))
+        throw std::runtime_error("Error reading the coordinator file " + c.coordinatorFile);
+    coordinator.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::vector<PhaseAction> phases = ReadPhaseScript(coordinator);
+
+    std::ostringstream log;
+    HeadlessSimulation simulation(c.config, c.inputFiles, &log, c.seed);
+    simulation.setPhases(phases);
+    simulation.setEventQueue(c.eventQueue);
+    simulation.run(startingNodeID, startingTime, c.timeLimit);
+    return log.str();
+}
+
+// Compares an event log with its golden log line by line. If they differ, writes the
+// first divergent event, with the event before it for context, and returns false.
+static bool CompareLogs(const std::string &expected, const std::string &actual, std::ostream &report) {
+    std::istringstream e(expected), a(actual);
+    std::string expectedLine, actualLine, previousLine;
+    for (long event = 1; ; event++) {
+        bool hasExpected = (bool)std::getline(e, expectedLine);
+        bool hasActual = (bool)std::getline(a, actualLine);
+        if (!hasExpected && !hasActual) return true;
+        if (hasExpected && hasActual && expectedLine == actualLine) {
+            previousLine = expectedLine;
+            continue;
+        }
+
+        report << "  first divergence at event " << event << std::endl;
+        if (event > 1) report << "  after:    " << previousLine << std::endl;
+        report << "  expected: " << (hasExpected ? expectedLine : "(end of log)") << std::endl
+               << "  actual:   " << (hasActual ? actualLine : "(end of log)") << std::endl;
+        return false;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string corpusFile = "headless/replay_corpus.txt";
+    std::string goldenDir = "headless/golden";
+    std::string only;
+    bool record = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0) {
+            record = true;
+            continue;
+        }
+        if (strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc) Usage();
+        std::string name = argv[i] + 2;
+        const char* value = argv[++i];
+
+        if (name == "corpus") corpusFile = value;
+        else if (name == "golden") goldenDir = value;
+        else if (name == "case") only = value;
+        else Usage();
+    }
+
+    std::vector<ReplayCase> cases;
+    try {
+        cases = ReadCorpus(corpusFile);
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    if (record && !MakeDirectory(goldenDir)) {
+        std::cerr << "Error creating " << goldenDir << std::endl;
+        return 1;
+    }
+
+    int passed = 0, failed = 0, missing = 0, recorded = 0;
+    for (const ReplayCase &c : cases) {
+        if (!only.empty() && c.name != only) continue;
+        std::string goldenFile = goldenDir + "/" + c.name + ".txt";
+
+        std::string log;
+        try {
+            log = RunCase(c);
+        }
+        catch (std::exception &e) {
+            std::cout << "FAIL    " << c.name << std::endl << "  " << e.what() << std::endl;
+            failed++;
+            continue;
+        }
+
+        if (record) {
+            std::ofstream out(goldenFile, std::ios::binary);
+            out << log;
+            if (!out.good()) {
+                std::cerr << "Error writing " << goldenFile << std::endl;
+                return 1;
+            }
+            std::cout << "RECORD  " << c.name << std::endl;
+            recorded++;
+            continue;
+        }
+
+        std::ifstream in(goldenFile, std::ios::binary);
+        if (!in.good()) {
+            std::cout << "MISSING " << c.name << " (" << goldenFile << ")" << std::endl;
+            missing++;
+            continue;
+        }
+        std::ostringstream golden;
+        golden << in.rdbuf();
+
+        std::ostringstream report;
+        if (CompareLogs(golden.str(), log, report)) {
+            std::cout << "PASS    " << c.name << std::endl;
+            passed++;
+        }
+        else {
+            std::cout << "FAIL    " << c.name << " (" << corpusFile << ":" << c.lineNumber << ")" << std::endl
+                      << report.str();
+            failed++;
+        }
+    }
+
+    if (record) {
+        std::cout << recorded << " golden logs recorded in " << goldenDir << std::endl;
+        return failed ? 1 : 0;
+    }
+    std::cout << passed << " passed, " << failed << " failed, " << missing << " missing" << std::endl;
+    return failed || missing ? 1 : 0;
+}
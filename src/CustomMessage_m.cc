@@ -183,6 +183,9 @@ CustomMessage_Base::CustomMessage_Base(const char *name, short kind) : ::omnetpp
     this->parity.reset();
     this->frameType = 0;
     this->ackSequence = 0;
+    this->moreFragments = false;
+    this->fragmentLine = 0;
+    this->fragmentIndex = 0;
 }
 
 CustomMessage_Base::CustomMessage_Base(const CustomMessage_Base& other) : ::omnetpp::cPacket(other)
@@ -209,6 +212,9 @@ void CustomMessage_Base::copy(const CustomMessage_Base& other)
     this->parity = std::bitset<8>(other.parity);
     this->frameType = other.frameType;
     this->ackSequence = other.ackSequence;
+    this->moreFragments = other.moreFragments;
+    this->fragmentLine = other.fragmentLine;
+    this->fragmentIndex = other.fragmentIndex;
 }
 
 void CustomMessage_Base::parsimPack(omnetpp::cCommBuffer *b) const
@@ -219,6 +225,9 @@ void CustomMessage_Base::parsimPack(omnetpp::cCommBuffer *b) const
     doParsimPacking(b,this->parity);
     doParsimPacking(b,this->frameType);
     doParsimPacking(b,this->ackSequence);
+    doParsimPacking(b,this->moreFragments);
+    doParsimPacking(b,this->fragmentLine);
+    doParsimPacking(b,this->fragmentIndex);
 }
 
 void CustomMessage_Base::parsimUnpack(omnetpp::cCommBuffer *b)
@@ -229,6 +238,9 @@ void CustomMessage_Base::parsimUnpack(omnetpp::cCommBuffer *b)
     doParsimUnpacking(b,this->parity);
     doParsimUnpacking(b,this->frameType);
     doParsimUnpacking(b,this->ackSequence);
+    doParsimUnpacking(b,this->moreFragments);
+    doParsimUnpacking(b,this->fragmentLine);
+    doParsimUnpacking(b,this->fragmentIndex);
 }
 
 int CustomMessage_Base::getDataSequence() const
@@ -281,6 +293,36 @@ void CustomMessage_Base::setAckSequence(int ackSequence)
     this->ackSequence = ackSequence;
 }
 
+bool CustomMessage_Base::getMoreFragments() const
+{
+    return this->moreFragments;
+}
+
+void CustomMessage_Base::setMoreFragments(bool moreFragments)
+{
+    this->moreFragments = moreFragments;
+}
+
+int CustomMessage_Base::getFragmentLine() const
+{
+    return this->fragmentLine;
+}
+
+void CustomMessage_Base::setFragmentLine(int fragmentLine)
+{
+    this->fragmentLine = fragmentLine;
+}
+
+int CustomMessage_Base::getFragmentIndex() const
+{
+    return this->fragmentIndex;
+}
+
+void CustomMessage_Base::setFragmentIndex(int fragmentIndex)
+{
+    this->fragmentIndex = fragmentIndex;
+}
+
 class CustomMessageDescriptor : public omnetpp::cClassDescriptor
 {
   private:
@@ -347,7 +389,7 @@ const char *CustomMessageDescriptor::getProperty(const char *propertyname) const
 int CustomMessageDescriptor::getFieldCount() const
 {
     omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
-    return basedesc ? 5+basedesc->getFieldCount() : 5;
+    return basedesc ? 8+basedesc->getFieldCount() : 8;
 }
 
 unsigned int CustomMessageDescriptor::getFieldTypeFlags(int field) const
@@ -364,8 +406,11 @@ unsigned int CustomMessageDescriptor::getFieldTypeFlags(int field) const
         FD_ISEDITABLE,
         FD_ISEDITABLE,
         FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
     };
-    return (field>=0 && field<5) ? fieldTypeFlags[field] : 0;
+    return (field>=0 && field<8) ? fieldTypeFlags[field] : 0;
 }
 
 const char *CustomMessageDescriptor::getFieldName(int field) const
@@ -382,8 +427,11 @@ const char *CustomMessageDescriptor::getFieldName(int field) const
         "parity",
         "frameType",
         "ackSequence",
+        "moreFragments",
+        "fragmentLine",
+        "fragmentIndex",
     };
-    return (field>=0 && field<5) ? fieldNames[field] : nullptr;
+    return (field>=0 && field<8) ? fieldNames[field] : nullptr;
 }
 
 int CustomMessageDescriptor::findField(const char *fieldName) const
@@ -395,6 +443,9 @@ int CustomMessageDescriptor::findField(const char *fieldName) const
     if (fieldName[0]=='p' && strcmp(fieldName, "parity")==0) return base+2;
     if (fieldName[0]=='f' && strcmp(fieldName, "frameType")==0) return base+3;
     if (fieldName[0]=='a' && strcmp(fieldName, "ackSequence")==0) return base+4;
+    if (fieldName[0]=='m' && strcmp(fieldName, "moreFragments")==0) return base+5;
+    if (fieldName[0]=='f' && strcmp(fieldName, "fragmentLine")==0) return base+6;
+    if (fieldName[0]=='f' && strcmp(fieldName, "fragmentIndex")==0) return base+7;
     return basedesc ? basedesc->findField(fieldName) : -1;
 }
 
@@ -412,8 +463,11 @@ const char *CustomMessageDescriptor::getFieldTypeString(int field) const
         "char",
         "char",
         "int",
+        "bool",
+        "int",
+        "int",
     };
-    return (field>=0 && field<5) ? fieldTypeStrings[field] : nullptr;
+    return (field>=0 && field<8) ? fieldTypeStrings[field] : nullptr;
 }
 
 const char **CustomMessageDescriptor::getFieldPropertyNames(int field) const
@@ -490,6 +544,9 @@ std::string CustomMessageDescriptor::getFieldValueAsString(void *object, int fie
         case 2: return pp->getParity().to_string();
         case 3: return long2string(pp->getFrameType());
         case 4: return long2string(pp->getAckSequence());
+        case 5: return bool2string(pp->getMoreFragments());
+        case 6: return long2string(pp->getFragmentLine());
+        case 7: return long2string(pp->getFragmentIndex());
         default: return "";
     }
 }
@@ -509,6 +566,9 @@ bool CustomMessageDescriptor::setFieldValueAsString(void *object, int field, int
         case 2: pp->setParity(std::bitset<8>(value)); return true;
         case 3: pp->setFrameType(string2long(value)); return true;
         case 4: pp->setAckSequence(string2long(value)); return true;
+        case 5: pp->setMoreFragments(string2bool(value)); return true;
+        case 6: pp->setFragmentLine(string2long(value)); return true;
+        case 7: pp->setFragmentIndex(string2long(value)); return true;
         default: return false;
     }
 }
@@ -35,6 +35,9 @@
  *     char parity; // 1-byte checksum
  *     char frameType; // Data=2,ACK=1,NACK=0
  *     int ackSequence; // ACK/NACK sequence number
+ *     bool moreFragments; // More fragments of the line follow
+ *     int fragmentLine; // Line the fragment is cut from
+ *     int fragmentIndex; // Index of the fragment in its line
  * }
  * </pre>
  *
@@ -63,16 +66,8 @@
  * </pre>
  */
 
-#define NACK_FRAME 0
-#define ACK_FRAME 1
-#define DATA_FRAME 2
-#define COORDINATOR_FRAME 3
-
-#define DELAY_OFFSET 4
-
-#define DELAYED_NACK_FRAME NACK_FRAME + DELAY_OFFSET
-#define DELAYED_ACK_FRAME ACK_FRAME + DELAY_OFFSET
-#define DELAYED_DATA_FRAME DATA_FRAME + DELAY_OFFSET
+// Frame types, shared with the kernel-independent protocol code.
+#include "frame.h"
 
 
 class CustomMessage_Base : public ::omnetpp::cPacket
@@ -83,6 +78,9 @@ class CustomMessage_Base : public ::omnetpp::cPacket
     std::bitset<8> parity;
     int frameType;
     int ackSequence;
+    bool moreFragments;
+    int fragmentLine;
+    int fragmentIndex;
 
   private:
     void copy(const CustomMessage_Base& other);
@@ -115,6 +113,12 @@ class CustomMessage_Base : public ::omnetpp::cPacket
     virtual void setFrameType(int frameType);
     virtual int getAckSequence() const;
     virtual void setAckSequence(int ackSequence);
+    virtual bool getMoreFragments() const;
+    virtual void setMoreFragments(bool moreFragments);
+    virtual int getFragmentLine() const;
+    virtual void setFragmentLine(int fragmentLine);
+    virtual int getFragmentIndex() const;
+    virtual void setFragmentIndex(int fragmentIndex);
 };
 
 
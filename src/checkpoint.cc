@@ -0,0 +1,85 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include <stdexcept>
+#include "checkpoint.h"
+
+void CheckpointWriter::writeString(const std::string &s) {
+    this->write<uint32_t>(s.size());
+    this->out.write(s.data(), s.size());
+}
+
+void CheckpointWriter::addFrame(const Frame* frame) {
+    uint32_t id = this->frameIds.size();
+    this->frameIds[frame] = id;
+
+    this->write<int32_t>(frame->dataSequence);
+    this->write<int32_t>(frame->frameType);
+    this->write<int32_t>(frame->ackSequence);
+    this->write<uint8_t>(frame->moreFragments);
+    this->write<int32_t>(frame->fragmentLine);
+    this->write<int32_t>(frame->fragmentIndex);
+    this->write<uint8_t>(frame->parity.to_ulong());
+    this->write<int64_t>(frame->bitLength);
+    this->write<uint32_t>(frame->payload.size());
+    for (const bitset8 &b : frame->payload) this->write<uint8_t>(b.to_ulong());
+}
+
+void CheckpointWriter::writeFrameRef(const Frame* frame) {
+    auto it = this->frameIds.find(frame);
+    if (it == this->frameIds.end())
+        throw std::runtime_error("Checkpoint refers to a frame that is not pending.");
+    this->write<uint32_t>(it->second);
+}
+
+void CheckpointReader::read(char* buffer, size_t size) {
+    if (!this->in.read(buffer, size))
+        throw std::runtime_error("Checkpoint is truncated.");
+}
+
+std::string CheckpointReader::readString() {
+    std::string s(this->read<uint32_t>(), '\0');
+    if (!s.empty()) this->read(&s[0], s.size());
+    return s;
+}
+
+Frame* CheckpointReader::addFrame() {
+    Frame* frame = new Frame();
+    try {
+        frame->dataSequence = this->read<int32_t>();
+        frame->frameType = this->read<int32_t>();
+        frame->ackSequence = this->read<int32_t>();
+        frame->moreFragments = this->read<uint8_t>() != 0;
+        frame->fragmentLine = this->read<int32_t>();
+        frame->fragmentIndex = this->read<int32_t>();
+        frame->parity = bitset8(this->read<uint8_t>());
+        frame->bitLength = (long)this->read<int64_t>();
+        frame->payload.resize(this->read<uint32_t>());
+        for (bitset8 &b : frame->payload) b = bitset8(this->read<uint8_t>());
+    }
+    catch (...) {
+        delete frame;
+        throw;
+    }
+    this->frames.push_back(frame);
+    return frame;
+}
+
+Frame* CheckpointReader::readFrameRef() {
+    uint32_t id = this->read<uint32_t>();
+    if (id >= this->frames.size())
+        throw std::runtime_error("Checkpoint refers to an unknown frame.");
+    return this->frames[id];
+}
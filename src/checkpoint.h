@@ -0,0 +1,81 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "frame.h"
+
+// Compact binary snapshots of a simulation, so that long runs can be resumed.
+// Values are written in the byte order of the host, so a snapshot is only meant
+// to be read back on the machine that wrote it.
+//
+// Frames are shared between the state of the protocol (its timers)
+// and the pending events of the scheduler. The scheduler writes each pending frame
+// once, with addFrame(), and the protocol then refers to it by its index.
+
+#define CHECKPOINT_MAGIC 0x54504b43474e4247ULL // "GBNGCKPT"
+#define CHECKPOINT_VERSION 11
+
+class CheckpointWriter {
+    std::ostream &out;
+    std::unordered_map<const Frame*, uint32_t> frameIds;
+public:
+    CheckpointWriter(std::ostream &out) : out(out) {}
+
+    template<typename T> void write(T value) {
+        static_assert(std::is_arithmetic<T>::value, "Only numbers are written as they are.");
+        out.write((const char*)&value, sizeof(T));
+    }
+    void writeString(const std::string &s);
+
+    // Writes the frame, which later references can then refer to.
+    void addFrame(const Frame* frame);
+
+    // Writes a reference to a frame written before with addFrame().
+    void writeFrameRef(const Frame* frame);
+};
+
+class CheckpointReader {
+    std::istream &in;
+    std::vector<Frame*> frames;
+
+    void read(char* buffer, size_t size);
+public:
+    CheckpointReader(std::istream &in) : in(in) {}
+
+    // Throws std::runtime_error if the snapshot ends early.
+    template<typename T> T read() {
+        static_assert(std::is_arithmetic<T>::value, "Only numbers are read as they are.");
+        T value;
+        read((char*)&value, sizeof(T));
+        return value;
+    }
+    std::string readString();
+
+    // Reads a new frame, owned by the caller.
+    Frame* addFrame();
+
+    // Reads a reference to a frame read before with addFrame().
+    Frame* readFrameRef();
+};
+
+#endif /* CHECKPOINT_H_ */
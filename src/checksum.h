@@ -0,0 +1,68 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef CHECKSUM_H_
+#define CHECKSUM_H_
+
+#include <cstdint>
+#include "util.h"
+#include "profiler.h"
+
+// The checksums a data frame can be sent with, chosen by the CS parameter. Each is a
+// policy with a static compute(), so that a ProtocolCore can resolve it at compile time.
+
+#define CHECKSUM_SUM 0
+#define CHECKSUM_CRC8 1
+
+// The 8-bit one's complement sum of CalculateChecksum, computed on integers: the sum of
+// the bytes with its carries folded back in is the same as adding with end-around carry.
+struct OnesComplementChecksum {
+    static bitset8 compute(vecBitset8 const &bytes) {
+        PROFILE_SCOPE(PROF_CALCULATE_CHECKSUM);
+        uint64_t sum = 0;
+        for (const bitset8 &b : bytes) sum += b.to_ulong();
+        while (sum >> 8) sum = (sum & 0xff) + (sum >> 8);
+        return bitset8(~sum & 0xff);
+    }
+};
+
+// CRC-8 with the polynomial x^8 + x^2 + x + 1 (0x07), which unlike the sum detects
+// every error of up to 8 adjacent bits and every odd number of flipped bits.
+struct Crc8Checksum {
+    static const uint8_t* table() {
+        struct Table {
+            uint8_t t[256];
+            Table() {
+                for (int v = 0; v < 256; v++) {
+                    uint8_t c = (uint8_t)v;
+                    for (int b = 0; b < 8; b++) c = (uint8_t)((c << 1) ^ ((c & 0x80) ? 0x07 : 0));
+                    t[v] = c;
+                }
+            }
+        };
+        static const Table crc;
+        return crc.t;
+    }
+
+    static bitset8 compute(vecBitset8 const &bytes) {
+        PROFILE_SCOPE(PROF_CALCULATE_CHECKSUM);
+        const uint8_t* t = table();
+        uint8_t crc = 0;
+        for (const bitset8 &b : bytes) crc = t[crc ^ (uint8_t)b.to_ulong()];
+        return bitset8(crc);
+    }
+};
+
+#endif /* CHECKSUM_H_ */
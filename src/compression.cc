@@ -0,0 +1,146 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include "compression.h"
+#include <chrono>
+#include <cstring>
+#include "profiler.h"
+
+static inline uint32_t HashOf(const char* p, int bits) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - bits);
+}
+
+static void AppendNumber(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out += char(0x80 | (v & 0x7f));
+        v >>= 7;
+    }
+    out += char(v);
+}
+
+static bool ReadNumber(std::string const& in, size_t &i, uint64_t &v) {
+    v = 0;
+    for (int shift = 0; i < in.size() && shift < 64; shift += 7) {
+        unsigned char c = in[i++];
+        v |= uint64_t(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+void PayloadCodec::compress(const char* data, size_t length, std::string &out) {
+    PROFILE_SCOPE(PROF_COMPRESS);
+    auto begin = std::chrono::steady_clock::now();
+
+    if (this->table.empty()) this->table.assign(size_t(1) << HASH_BITS, 0);
+    if (uint64_t(this->base) + length + 1 > UINT32_MAX) {
+        std::fill(this->table.begin(), this->table.end(), 0);
+        this->base = 0;
+    }
+    uint32_t base = this->base + 1;
+
+    out.clear();
+    size_t literals = 0;
+    auto flushLiterals = [&](size_t end) {
+        for (; literals < end; literals++) {
+            out += data[literals];
+            if ((unsigned char)data[literals] == MARKER) out += char(1);
+        }
+    };
+
+    for (size_t i = 0; i + MIN_MATCH <= length; ) {
+        uint32_t &entry = this->table[HashOf(data + i, HASH_BITS)];
+        size_t candidate = entry >= base ? entry - base : SIZE_MAX;
+        entry = base + uint32_t(i);
+
+        if (candidate == SIZE_MAX || i - candidate > MAX_DISTANCE || memcmp(data + candidate, data + i, MIN_MATCH) != 0) {
+            i++;
+            continue;
+        }
+
+        size_t matched = MIN_MATCH;
+        while (i + matched < length && matched < MAX_MATCH && data[candidate + matched] == data[i + matched]) matched++;
+
+        flushLiterals(i);
+        out += char(MARKER);
+        AppendNumber(out, matched - MIN_MATCH + 2);
+        AppendNumber(out, i - candidate);
+        i += matched;
+        literals = i;
+    }
+    flushLiterals(length);
+    this->base = base + uint32_t(length);
+
+    this->framesCompressed++;
+    this->bytesBeforeCompression += length;
+    this->bytesAfterCompression += out.size();
+    this->compressionTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+bool PayloadCodec::decompress(std::string const& in, std::string &out) {
+    PROFILE_SCOPE(PROF_DECOMPRESS);
+    auto begin = std::chrono::steady_clock::now();
+
+    out.clear();
+    bool valid = true;
+    for (size_t i = 0; i < in.size() && valid; ) {
+        unsigned char c = in[i++];
+        if (c != MARKER) {
+            out += char(c);
+            continue;
+        }
+
+        uint64_t v, distance;
+        valid = ReadNumber(in, i, v) && v > 0;
+        if (valid && v == 1) {
+            out += char(MARKER);
+            continue;
+        }
+        size_t matched = size_t(v - 2) + MIN_MATCH;
+        valid = valid && v - 2 <= MAX_MATCH - MIN_MATCH && ReadNumber(in, i, distance) && distance > 0 && distance <= out.size();
+        if (!valid) break;
+
+        // The match may overlap the bytes it produces.
+        size_t from = out.size() - distance;
+        for (size_t k = 0; k < matched; k++) out += out[from + k];
+    }
+
+    this->framesDecompressed++;
+    if (!valid) this->decompressionErrors++;
+    this->decompressionTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return valid;
+}
+
+void PayloadCodec::save(CheckpointWriter &out) const {
+    out.write<int64_t>(this->framesCompressed);
+    out.write<int64_t>(this->bytesBeforeCompression);
+    out.write<int64_t>(this->bytesAfterCompression);
+    out.write<double>(this->compressionTime);
+    out.write<int64_t>(this->framesDecompressed);
+    out.write<int64_t>(this->decompressionErrors);
+    out.write<double>(this->decompressionTime);
+}
+
+void PayloadCodec::load(CheckpointReader &in) {
+    this->framesCompressed = (long)in.read<int64_t>();
+    this->bytesBeforeCompression = (long)in.read<int64_t>();
+    this->bytesAfterCompression = (long)in.read<int64_t>();
+    this->compressionTime = in.read<double>();
+    this->framesDecompressed = (long)in.read<int64_t>();
+    this->decompressionErrors = (long)in.read<int64_t>();
+    this->decompressionTime = in.read<double>();
+}
@@ -0,0 +1,65 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef COMPRESSION_H_
+#define COMPRESSION_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "checkpoint.h"
+
+// Compression of the data frame payloads before they are framed: a byte-oriented LZ77
+// codec, matching repeated strings of MIN_MATCH bytes or more within the payload.
+//
+// The compressed payload is the literal bytes of the payload, except that a repeated
+// string is replaced by MARKER, its length and its distance back, both as LEB128 numbers.
+// MARKER itself is sent as MARKER followed by 1. MARKER (0xff) never occurs in UTF-8
+// text, and a positive LEB128 number has no zero bytes, so a payload without NUL bytes
+// is compressed into one without NUL bytes, which keeps the event log readable.
+class PayloadCodec {
+    static const unsigned char MARKER = 0xff;
+    static const size_t MIN_MATCH = 5;
+    static const size_t MAX_MATCH = 1 << 16;
+    static const size_t MAX_DISTANCE = 1 << 16;
+    static const int HASH_BITS = 12;
+
+    // The position of the last string seen with each hash, offset by `base`. Positions
+    // from earlier payloads are below `base`, so the table never has to be cleared.
+    std::vector<uint32_t> table;
+    uint32_t base = 0;
+public:
+    long framesCompressed = 0;
+    long bytesBeforeCompression = 0;
+    long bytesAfterCompression = 0;
+    double compressionTime = 0;
+
+    long framesDecompressed = 0;
+    long decompressionErrors = 0;
+    double decompressionTime = 0;
+
+    // Compresses `length` bytes of `data` into `out`, replacing its contents.
+    void compress(const char* data, size_t length, std::string &out);
+
+    // Decompresses `in` into `out`. Returns false, leaving `out` incomplete, if `in` is
+    // not a valid compressed payload.
+    bool decompress(std::string const& in, std::string &out);
+
+    // The counters, for checkpoints.
+    void save(CheckpointWriter &out) const;
+    void load(CheckpointReader &in);
+};
+
+#endif /* COMPRESSION_H_ */
@@ -14,39 +14,45 @@
 // 
 
 #include "coordinator.h"
+#include "node.h"
 #include "CustomMessage_m.h"
 #include "util.h"
+#include "profiler.h"
 Define_Module(Coordinator);
 
-void Coordinator::setGlobalInfo()
+Coordinator::~Coordinator()
 {
-    // Set shared info according to parameters
-    Info::windowSize = (int)getParentModule()->par("WS");
-    Info::timeout = getParentModule()->par("TO").doubleValue();
-    Info::processingTime = getParentModule()->par("PT").doubleValue();
-    Info::transmissionDelay = getParentModule()->par("TD").doubleValue();
-    Info::errorDelay = getParentModule()->par("ED").doubleValue();
-    Info::duplicationDelay = getParentModule()->par("DD").doubleValue();
-    Info::ackLossProb = getParentModule()->par("LP").doubleValue();
+    cancelAndDelete(this->telemetryTimer);
+    cancelAndDelete(this->phaseTimer);
+}
 
-    Info::log.open("..\\output.txt");
-    if (!Info::log.good())
+void Coordinator::openLog()
+{
+    this->log.open("..\\output.txt");
+    if (!this->log.good())
         throw std::runtime_error("Error opening log file.");
 }
 
+std::ostream& Coordinator::getLog()
+{
+    return this->log;
+}
+
 void Coordinator::initialize()
 {
-    this->setGlobalInfo();
+    this->wallClockStart = std::chrono::steady_clock::now();
+    this->openLog();
 
     // Opening coordinator file and reading starting info.
     coordinatorFile.open("..\\src\\coordinator.txt");
-    if (!coordinatorFile.good()) {
-        std::cerr << "Error opening the coordinator.txt file" << std::endl;
-        exit(1);
-    }
+    if (!coordinatorFile.good())
+        throw std::runtime_error("Error opening the coordinator.txt file");
 
     std::string line;
     std::getline(coordinatorFile, line);
+
+    // Any further lines are the phase script.
+    this->phases = ReadPhaseScript(coordinatorFile);
     coordinatorFile.close();
 
     // Sending the starting info the the nodes
@@ -55,9 +61,76 @@ void Coordinator::initialize()
     initMsg->setFrameType(COORDINATOR_FRAME);
     send(initMsg, "node0$o");
     send(initMsg->dup(), "node1$o");
+
+    if (!this->phases.empty()) {
+        this->phaseTimer = new cMessage("phase");
+        scheduleAt(this->phases[0].time, this->phaseTimer);
+    }
+
+    // Sampled every TI seconds from then on, and once more at the end of the run.
+    this->telemetryInterval = getParentModule()->par("TI").doubleValue();
+    if (this->telemetryInterval > 0) {
+        this->telemetry.open(getParentModule()->par("TF").stdstringValue());
+        this->telemetryTimer = new cMessage("telemetry");
+        scheduleAt(this->telemetryInterval, this->telemetryTimer);
+    }
 }
 
 void Coordinator::handleMessage(cMessage *msg)
 {
-    // TODO - Generated method body
+    if (msg == this->telemetryTimer) {
+        this->writeTelemetry();
+        scheduleAt(simTime() + this->telemetryInterval, this->telemetryTimer);
+    }
+    else if (msg == this->phaseTimer) {
+        this->sendPhaseActions();
+        if (this->nextPhase < this->phases.size())
+            scheduleAt(this->phases[this->nextPhase].time, this->phaseTimer);
+    }
+}
+
+void Coordinator::sendPhaseActions()
+{
+    for (; this->nextPhase < this->phases.size() && this->phases[this->nextPhase].time <= simTime().dbl(); this->nextPhase++) {
+        const PhaseAction &action = this->phases[this->nextPhase];
+        for (int i = 0; i < 2; i++) {
+            if (action.node != -1 && action.node != i) continue;
+            CustomMessage_Base *controlMsg = new CustomMessage_Base();
+            controlMsg->setPayload(ConvertStringToBits(action.command()));
+            controlMsg->setFrameType(CONTROL_FRAME);
+            send(controlMsg, i ? "node1$o" : "node0$o");
+        }
+    }
+}
+
+void Coordinator::writeTelemetry()
+{
+    const Protocol* nodes[2];
+    for (int i = 0; i < 2; i++) {
+        Node* node = check_and_cast<Node*>(getParentModule()->getSubmodule(i ? "node1" : "node0"));
+        nodes[i] = node->getProtocol();
+    }
+    this->telemetry.write(simTime().dbl(), getSimulation()->getEventNumber(), nodes);
+}
+
+void Coordinator::finish()
+{
+    // Totals of the whole run; the per-node totals are recorded by the nodes.
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->wallClockStart).count();
+    eventnumber_t events = getSimulation()->getEventNumber();
+    recordScalar("events", events);
+    recordScalar("wallTime", wallTime);
+    if (wallTime > 0) recordScalar("eventsPerSecond", events / wallTime);
+
+    // A last sample at the end of the run.
+    if (this->telemetry.isOpen()) this->writeTelemetry();
+
+    this->log.close();
+
+#ifdef GBN_PROFILE
+    std::ostringstream profile;
+    Profiler::kernel.dump(profile, "the simulation kernel");
+    EV << profile.str();
+    recordScalar("profile:kernel:ticks", Profiler::kernel.counters[PROF_KERNEL].ticks);
+#endif
 }
@@ -17,7 +17,10 @@
 #define __PROJCET_COORDINATOR_H_
 
 #include <omnetpp.h>
+#include <chrono>
 #include <fstream>
+#include "telemetry.h"
+#include "phases.h"
 
 using namespace omnetpp;
 
@@ -26,14 +29,43 @@ using namespace omnetpp;
  */
 class Coordinator : public cSimpleModule
 {
+  public:
+    virtual ~Coordinator();
+
+    // The log file shared between sender and receiver `output.txt`.
+    virtual std::ostream& getLog();
+
   protected:
     virtual void initialize();
     virtual void handleMessage(cMessage *msg);
-    virtual void setGlobalInfo();
+    virtual void finish();
+
+    // Opens the log file of the network.
+    virtual void openLog();
+    std::ofstream log;
     std::ifstream coordinatorFile;
+
+    // When the run started, for the events per wall-clock second.
+    std::chrono::steady_clock::time_point wallClockStart;
     int startingNodeID;
     float startingTime;
 
+    // The phase script following the starting info, and the self-message sending
+    // each action to the nodes at its time.
+    std::vector<PhaseAction> phases;
+    size_t nextPhase = 0;
+    cMessage *phaseTimer = NULL;
+
+    // Sends the actions that are due to the nodes as control frames.
+    virtual void sendPhaseActions();
+
+    // The self-message sampling the telemetry every TI seconds, if TI is set.
+    cMessage *telemetryTimer = NULL;
+    simtime_t telemetryInterval;
+    TelemetryWriter telemetry;
+
+    // Writes a line of telemetry with the state of both nodes.
+    virtual void writeTelemetry();
 };
 
 #endif
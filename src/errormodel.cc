@@ -0,0 +1,139 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include <cmath>
+#include <algorithm>
+#include "errormodel.h"
+
+void ChannelErrorModel::configure(const LinkConfig &config, Scheduler* random) {
+    this->random = random;
+    this->rng = config.errorRng;
+    this->bitErrorRate = config.bitErrorRate;
+    this->goodToBad = config.goodToBadProb;
+    this->badToGood = config.badToGoodProb;
+    this->lossGood = config.goodLossProb;
+    this->lossBad = config.badLossProb;
+    this->duplicationProb = config.randomDuplicationProb;
+    this->reorderProb = config.reorderProb;
+    this->reorderDelay = config.errorDelay;
+}
+
+bool ChannelErrorModel::isActive() const {
+    return this->bitErrorRate > 0 || this->goodToBad > 0 || this->lossGood > 0
+            || this->duplicationProb > 0 || this->reorderProb > 0;
+}
+
+void ChannelErrorModel::flipBits(vecBitset8 &payload, ChannelErrors &e) {
+
+    long totalBits = (long)payload.size() * 8;
+    if (this->bitErrorRate <= 0 || totalBits == 0) return;
+
+    // Skipping over the error-free bits with geometrically distributed gaps,
+    // instead of drawing a random number for every bit.
+    double logKeep = std::log1p(-std::min(this->bitErrorRate, 1.0 - 1e-12));
+    long bit = -1;
+    while (true) {
+        bit += 1 + (long)std::floor(std::log1p(-this->random->uniformRandom(0, 1, this->rng)) / logKeep);
+        if (bit >= totalBits) break;
+
+        payload[bit/8][bit%8] = (~payload[bit/8][bit%8]);
+        if (e.firstModifiedBit == -1) e.firstModifiedBit = (int)bit;
+        e.modifiedBits++;
+    }
+
+    if (e.modifiedBits) {
+        this->framesCorrupted++;
+        this->bitsFlipped += e.modifiedBits;
+    }
+}
+
+bool ChannelErrorModel::draw(double p) {
+    return p > 0 && this->random->uniformRandom(0, 1, this->rng) < p;
+}
+
+ChannelErrors ChannelErrorModel::applyToFrame(vecBitset8 &payload) {
+
+    ChannelErrors e;
+    if (!this->isActive()) return e;
+
+    // Gilbert-Elliott: a state transition per frame, then a loss with the state's probability.
+    if (this->goodToBad > 0)
+        this->bad = this->bad ? !this->draw(this->badToGood) : this->draw(this->goodToBad);
+    if (this->draw(this->bad ? this->lossBad : this->lossGood)) {
+        e.lost = true;
+        this->framesLost++;
+    }
+
+    this->flipBits(payload, e);
+
+    if (this->draw(this->duplicationProb)) {
+        e.duplicated = true;
+        this->framesDuplicated++;
+    }
+    if (this->draw(this->reorderProb)) {
+        e.extraDelay = this->reorderDelay;
+        this->framesReordered++;
+    }
+
+    return e;
+}
+
+ChannelErrors ChannelErrorModel::applyToControl(long bits) {
+
+    ChannelErrors e;
+    if (!this->isActive()) return e;
+
+    if (this->goodToBad > 0)
+        this->bad = this->bad ? !this->draw(this->badToGood) : this->draw(this->goodToBad);
+
+    bool lost = this->draw(this->bad ? this->lossBad : this->lossGood);
+    if (!lost && this->bitErrorRate > 0) {
+        lost = this->draw(1 - std::pow(1 - std::min(this->bitErrorRate, 1.0), (double)bits));
+        if (lost) this->framesCorrupted++;
+    }
+    if (lost) {
+        e.lost = true;
+        this->framesLost++;
+    }
+
+    if (this->draw(this->duplicationProb)) {
+        e.duplicated = true;
+        this->framesDuplicated++;
+    }
+    if (this->draw(this->reorderProb)) {
+        e.extraDelay = this->reorderDelay;
+        this->framesReordered++;
+    }
+
+    return e;
+}
+
+void ChannelErrorModel::save(CheckpointWriter &out) const {
+    out.write<uint8_t>(this->bad);
+    out.write<int64_t>(this->framesLost);
+    out.write<int64_t>(this->framesCorrupted);
+    out.write<int64_t>(this->bitsFlipped);
+    out.write<int64_t>(this->framesDuplicated);
+    out.write<int64_t>(this->framesReordered);
+}
+
+void ChannelErrorModel::load(CheckpointReader &in) {
+    this->bad = in.read<uint8_t>();
+    this->framesLost = (long)in.read<int64_t>();
+    this->framesCorrupted = (long)in.read<int64_t>();
+    this->bitsFlipped = (long)in.read<int64_t>();
+    this->framesDuplicated = (long)in.read<int64_t>();
+    this->framesReordered = (long)in.read<int64_t>();
+}
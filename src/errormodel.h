@@ -0,0 +1,84 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef ERRORMODEL_H_
+#define ERRORMODEL_H_
+
+#include "util.h"
+#include "scheduler.h"
+#include "checkpoint.h"
+
+// The impairments drawn for a single frame by the ChannelErrorModel.
+// firstModifiedBit => Position of the first flipped payload bit, -1 if none.
+// extraDelay       => Delay holding the frame back so that later frames overtake it.
+struct ChannelErrors {
+    bool lost = false;
+    bool duplicated = false;
+    int modifiedBits = 0;
+    int firstModifiedBit = -1;
+    double extraDelay = 0;
+};
+
+// Statistical channel impairments applied on top of the per-line error codes:
+// independent bit errors, Gilbert-Elliott burst loss, and random duplication
+// and reordering. Each transmitting node owns one model, so the Gilbert-Elliott
+// state is tracked per direction. No random numbers are drawn while every
+// probability is zero, keeping runs without the model unchanged.
+class ChannelErrorModel {
+    double bitErrorRate = 0;
+    double goodToBad = 0;
+    double badToGood = 1;
+    double lossGood = 0;
+    double lossBad = 1;
+    double duplicationProb = 0;
+    double reorderProb = 0;
+    double reorderDelay = 0;
+
+    // Whether the Gilbert-Elliott channel is currently in the bad state.
+    bool bad = false;
+
+    // The source of the random numbers, and the index of its RNG to draw from.
+    Scheduler* random = NULL;
+    int rng = 0;
+
+    bool draw(double p);
+
+    // Flips each bit of the payload independently with the bit error rate.
+    void flipBits(vecBitset8 &payload, ChannelErrors &e);
+public:
+    long framesLost = 0;
+    long framesCorrupted = 0;
+    long bitsFlipped = 0;
+    long framesDuplicated = 0;
+    long framesReordered = 0;
+
+    // Reads the model parameters from the link configuration, drawing random numbers from the given scheduler.
+    void configure(const LinkConfig &config, Scheduler* random);
+    bool isActive() const;
+
+    // Draws the impairments of a data frame, flipping its payload bits in place.
+    ChannelErrors applyToFrame(vecBitset8 &payload);
+
+    // Draws the impairments of a frame without payload of the given length,
+    // such as an ack. Any bit error makes it undecodable, so it counts as lost.
+    ChannelErrors applyToControl(long bits);
+
+    // The channel state and counters, for checkpoints. The parameters are not
+    // included; they are configured anew on resume.
+    void save(CheckpointWriter &out) const;
+    void load(CheckpointReader &in);
+};
+
+#endif /* ERRORMODEL_H_ */
@@ -0,0 +1,127 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include "fec.h"
+#include <algorithm>
+#include "profiler.h"
+
+// The data bits of a block take the Hamming code positions 1..71 that are not powers of two,
+// so the syndrome of a block is the XOR of the positions of its set data bits and parity bits.
+// Syndromes[j][v] is the contribution of value v in the jth byte of the block.
+struct FecTables {
+    uint8_t syndromes[8][256];
+    uint8_t position[72];
+
+    FecTables() {
+        int bit = 0;
+        for (int p = 1; p < 72; p++) {
+            if ((p & (p - 1)) == 0) continue;
+            position[bit++] = (uint8_t)p;
+        }
+        for (int j = 0; j < 8; j++) {
+            for (int v = 0; v < 256; v++) {
+                uint8_t s = 0;
+                for (int b = 0; b < 8; b++) if (v & (1 << b)) s ^= position[j * 8 + b];
+                syndromes[j][v] = s;
+            }
+        }
+    }
+};
+
+static const FecTables &Tables() {
+    static const FecTables tables;
+    return tables;
+}
+
+static inline int Parity(unsigned v) {
+    return bitset8(v).count() & 1;
+}
+
+// The syndrome and the parity of the data bits of the block starting at byte `start`.
+static void BlockSyndrome(vecBitset8 const& payload, size_t start, size_t end, uint8_t &syndrome, int &parity) {
+    const FecTables &t = Tables();
+    syndrome = 0;
+    parity = 0;
+    for (size_t i = start; i < end; i++) {
+        unsigned v = payload[i].to_ulong();
+        syndrome ^= t.syndromes[i - start][v];
+        parity ^= Parity(v);
+    }
+}
+
+size_t FecCheckBytes(size_t length) {
+    return (length + 7) / 8;
+}
+
+size_t FecDataBytes(size_t length) {
+    // n data bytes take n + ceil(n/8) bytes encoded.
+    return length - (length + 8) / 9;
+}
+
+void FecEncode(vecBitset8 &payload) {
+    size_t length = payload.size();
+    payload.reserve(length + FecCheckBytes(length));
+
+    for (size_t start = 0; start < length; start += 8) {
+        uint8_t syndrome;
+        int parity;
+        BlockSyndrome(payload, start, std::min(length, start + 8), syndrome, parity);
+
+        // The 7 parity bits make the syndrome zero, and the overall parity bit makes the block even.
+        uint8_t check = syndrome & 0x7f;
+        check |= (parity ^ Parity(check)) << 7;
+        payload.push_back(bitset8(check));
+    }
+}
+
+FecResult FecDecode(vecBitset8 &payload) {
+    PROFILE_SCOPE(PROF_FEC_DECODE);
+
+    FecResult result;
+    size_t length = FecDataBytes(payload.size());
+
+    for (size_t start = 0, block = 0; start < length; start += 8, block++) {
+        uint8_t syndrome;
+        int parity;
+        BlockSyndrome(payload, start, std::min(length, start + 8), syndrome, parity);
+
+        unsigned check = payload[length + block].to_ulong();
+        syndrome ^= check & 0x7f;
+        parity ^= Parity(check);
+
+        if (!syndrome && !parity) continue;
+        if (!parity) {
+            result.uncorrectable = true;
+            continue;
+        }
+
+        // A single error: in the overall parity bit, a Hamming parity bit, or the data bit at the syndrome.
+        result.correctedBits++;
+        if (!syndrome || (syndrome & (syndrome - 1)) == 0) continue;
+
+        const uint8_t* position = Tables().position;
+        int bit = 0;
+        while (bit < 64 && position[bit] != syndrome) bit++;
+        if (bit == 64 || start + bit / 8 >= length) {
+            result.correctedBits--;
+            result.uncorrectable = true;
+            continue;
+        }
+        payload[start + bit / 8].flip(bit % 8);
+    }
+
+    payload.resize(length);
+    return result;
+}
@@ -0,0 +1,49 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef FEC_H_
+#define FEC_H_
+
+#include "util.h"
+
+// Forward error correction of the framed data frame payloads: an extended Hamming
+// (72,64) SECDED code. Every block of 8 payload bytes gets one check byte, 7 Hamming
+// parity bits and an overall parity bit, which corrects any single flipped bit of the
+// block and detects any two. The check bytes follow the payload, one per block; the
+// last block is padded with zero bytes for the code only.
+
+#define FEC_NONE 0
+#define FEC_SECDED 1
+
+// The outcome of decoding a payload.
+struct FecResult {
+    int correctedBits = 0;
+    bool uncorrectable = false;
+};
+
+// The number of check bytes of a payload of `length` bytes.
+size_t FecCheckBytes(size_t length);
+
+// The number of payload bytes of an encoded payload of `length` bytes.
+size_t FecDataBytes(size_t length);
+
+// Appends the check bytes to the payload.
+void FecEncode(vecBitset8 &payload);
+
+// Corrects the payload in place and removes its check bytes. Blocks with errors
+// that cannot be corrected are left as they are.
+FecResult FecDecode(vecBitset8 &payload);
+
+#endif /* FEC_H_ */
@@ -0,0 +1,60 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include "util.h"
+
+#define NACK_FRAME 0
+#define ACK_FRAME 1
+#define DATA_FRAME 2
+#define COORDINATOR_FRAME 3
+#define START_FRAME 8
+
+// A phase action of the coordinator, with the command as its payload (see PhaseAction).
+#define CONTROL_FRAME 9
+
+// A frame as seen by the protocol, independent of the simulation kernel.
+// The fields mirror CustomMessage, which carries frames between OMNeT++ modules.
+struct Frame {
+    int dataSequence = 0;
+    vecBitset8 payload;
+    bitset8 parity;
+    int frameType = 0;
+    int ackSequence = 0;
+
+    // Set on every fragment of a line but its last.
+    bool moreFragments = false;
+
+    // The line a fragment is cut from and its index in the line, for the receiver to
+    // tell the fragments of the line it is reassembling from stale ones.
+    int fragmentLine = 0;
+    int fragmentIndex = 0;
+
+    // Length on the wire, set when the frame is put on the link.
+    long bitLength = 0;
+
+    // Bookkeeping of the scheduler while the frame is scheduled as a self-message.
+    void* handle = NULL;
+
+    Frame* dup() const {
+        Frame* f = new Frame(*this);
+        f->handle = NULL;
+        return f;
+    }
+};
+
+#endif /* FRAME_H_ */
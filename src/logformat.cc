@@ -0,0 +1,107 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include "logformat.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+const char* LogFormatter::nextConversion(const char* f) {
+    while (true) {
+        const char* percent = strchr(f, '%');
+        if (!percent) {
+            this->buffer.append(f);
+            return NULL;
+        }
+        this->buffer.append(f, percent - f);
+        f = percent + 1;
+        if (*f == '%') {
+            this->buffer += '%';
+            f++;
+            continue;
+        }
+
+        this->precision = -1;
+        if (*f == '.') {
+            this->precision = 0;
+            for (f++; *f >= '0' && *f <= '9'; f++) this->precision = this->precision * 10 + (*f - '0');
+        }
+        while (*f == 'l') f++;
+        return *f ? f + 1 : f;
+    }
+}
+
+void LogFormatter::appendUnsigned(unsigned long long v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = char('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) this->buffer += digits[--n];
+}
+
+void LogFormatter::appendSigned(long long v) {
+    if (v < 0) {
+        this->buffer += '-';
+        this->appendUnsigned(0ULL - (unsigned long long)v);
+    }
+    else this->appendUnsigned((unsigned long long)v);
+}
+
+void LogFormatter::appendFixed(double v, int digits) {
+
+    // The number scaled to an integer rounds the same as snprintf unless it lies close to
+    // a tie, where the scaling error could decide it. Below 1e9 that error is under 1e-6.
+    // Numbers close to a tie, and negative or large ones, are left to snprintf, still
+    // without allocating.
+    static const double scales[] = {1, 10, 100, 1e3, 1e4, 1e5, 1e6};
+    double scaled = (digits >= 0 && digits <= 6 && !std::signbit(v)) ? v * scales[digits] : -1;
+    if (scaled >= 0 && scaled < 1e9) {
+        double whole = std::floor(scaled);
+        double fraction = scaled - whole;
+        if (std::fabs(fraction - 0.5) > 1e-6) {
+            unsigned long long n = (unsigned long long)whole + (fraction > 0.5 ? 1 : 0);
+            unsigned long long scale = (unsigned long long)scales[digits];
+            this->appendUnsigned(n / scale);
+            if (digits) {
+                this->buffer += '.';
+                unsigned long long rest = n % scale;
+                for (unsigned long long s = scale / 10; s; s /= 10) {
+                    this->buffer += char('0' + rest / s);
+                    rest %= s;
+                }
+            }
+            return;
+        }
+    }
+
+    char formatted[64];
+    int n = snprintf(formatted, sizeof(formatted), "%.*f", digits, v);
+    if (n > 0) this->buffer.append(formatted, std::min<size_t>(n, sizeof(formatted) - 1));
+}
+
+void LogFormatter::put(const PayloadView &p) {
+    size_t length = std::min(p.length, p.bytes.size());
+    for (size_t i = 0; i < length; i++) {
+        char c = (char)p.bytes[i].to_ulong();
+        if (!c) break;
+        this->buffer += c;
+    }
+}
+
+void LogFormatter::put(const BitsView &b) {
+    for (int i = 7; i >= 0; i--) this->buffer += b.bits[i] ? '1' : '0';
+}
@@ -0,0 +1,87 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef LOGFORMAT_H_
+#define LOGFORMAT_H_
+
+#include <cstring>
+#include <string>
+#include "util.h"
+
+// The bytes of a payload as characters, as ConvertBitsToString() gives them, formatted
+// straight from the payload. At most `length` bytes are shown, and like any %s argument
+// they end at the first NUL.
+struct PayloadView {
+    const vecBitset8 &bytes;
+    size_t length;
+    PayloadView(const vecBitset8 &bytes, size_t length = SIZE_MAX) : bytes(bytes), length(length) {}
+};
+
+// The bits of a byte, most significant first, as bitset::to_string() gives them.
+struct BitsView {
+    bitset8 bits;
+    BitsView(bitset8 bits) : bits(bits) {}
+};
+
+// Printf-style formatting of the event log lines into a buffer reused from line to line,
+// so that formatting a line allocates nothing once the buffer has grown to the longest
+// line. The output is that of snprintf for the conversions the log uses: %d, %u, %ld and
+// %lu on integers, %.Nf on floating point numbers, %s on strings and the views above,
+// and %%. Flags and widths are not supported. Lines are not truncated.
+class LogFormatter {
+    std::string buffer;
+
+    // The precision of the conversion being formatted, -1 if not given.
+    int precision = -1;
+
+    void appendUnsigned(unsigned long long v);
+    void appendSigned(long long v);
+    void appendFixed(double v, int digits);
+
+    void put(int v) { appendSigned(v); }
+    void put(long v) { appendSigned(v); }
+    void put(long long v) { appendSigned(v); }
+    void put(unsigned v) { appendUnsigned(v); }
+    void put(unsigned long v) { appendUnsigned(v); }
+    void put(unsigned long long v) { appendUnsigned(v); }
+    void put(double v) { appendFixed(v, precision < 0 ? 6 : precision); }
+    void put(const char* s) { buffer.append(s); }
+    void put(const std::string &s) { buffer.append(s.c_str()); }
+    void put(const PayloadView &p);
+    void put(const BitsView &b);
+
+    // Copies the format up to the next conversion, and reads its precision.
+    // Returns the rest of the format after it, or NULL at the end of the format.
+    const char* nextConversion(const char* f);
+
+    void formatFrom(const char* f) {
+        while ((f = nextConversion(f))) {}
+    }
+    template<typename T, typename... Args> void formatFrom(const char* f, const T &arg, const Args&... args) {
+        f = nextConversion(f);
+        if (!f) return;
+        put(arg);
+        formatFrom(f, args...);
+    }
+public:
+    // Formats the line, which stays valid until the next call.
+    template<typename... Args> const std::string& format(const char* f, const Args&... args) {
+        buffer.clear();
+        formatFrom(f, args...);
+        return buffer;
+    }
+};
+
+#endif /* LOGFORMAT_H_ */
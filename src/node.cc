@@ -14,21 +14,12 @@
 // 
 
 #include "node.h"
+#include "coordinator.h"
+#include "protocolcore.h"
 #include <stdio.h>
 
 Define_Module(Node);
 
-template<typename... Args> void Node::log(const char * f, Args... args) {
-
-    char buffer[1024];
-    if (snprintf(buffer, 1024, f, args...) < 0) std::cerr << "Error formatting buffer" << std::endl;
-
-    Info::log << buffer << std::endl;
-    Info::log.flush();
-
-    EV << buffer << std::endl;
-}
-
 void Node::initialize()
 {
     this->id = int(this->getName()[strlen(this->getName())-1] - '0');
@@ -37,378 +28,158 @@ void Node::initialize()
     if (status < 0)
         throw std::runtime_error("Failed to format file name in node: " + std::to_string(this->id));
 
-    input = new TextFile(std::string(fileName));
-}
-
-void Node::getInitializationInfo(CustomMessage_Base* msg) {
-    std::istringstream iss(ConvertBitsToString(*msg->getPayload()));
-    int startingNodeID;
-
-    if ( !(iss >> startingNodeID >> this->senderInfo.startingTime) ) {
-        std::cerr << "Invalid format of the coordinator message payload" << std::endl;
-        exit(1);
-    }
-
-    if (startingNodeID == this->id) {
-        isSender = true;
+    LinkConfig config;
+    this->readConfig(config);
+    this->log = &check_and_cast<Coordinator*>(getParentModule()->getSubmodule("coordinator"))->getLog();
 
-        // We only need to open the file if we are the sender.
-        this->input->OpenFile();
-        this->input->SetBufferSize(Info::windowSize);
+    input = new TextFile(std::string(fileName));
+    protocol = CreateProtocol(this->id, config, this, input);
 
-        // Starting operation at the set starting time
-        CustomMessage_Base* initialMsg = new CustomMessage_Base("");
-        initialMsg->setAckSequence(-1);
-        scheduleAt(this->senderInfo.startingTime, initialMsg);
+    // The peer's input, to check the delivered data against if this node turns out the receiver.
+    if (!config.deliveryOutput.empty()) {
+        std::snprintf(fileName, 32, "..\\src\\input%d.txt", 1 - this->id);
+        peerInput = new TextFile(std::string(fileName));
+        protocol->setDeliveryReference(peerInput);
     }
-    return;
-}
-
-int Node::modulus(int a) {
-    int b = Info::windowSize + 1;
-    return ((a % b) + b) % b;
 }
 
-int Node::modifyPayload(vecBitset8 &payload) {
-    int bit = intuniform(0,payload.size()*8);
-    payload[int(bit/8)][bit%8] = (~payload[int(bit/8)][bit%8]);
-    return bit;
+cPar& Node::linkPar(const char* name) {
+    return hasPar(name) ? par(name) : getParentModule()->par(name);
+}
+
+void Node::readConfig(LinkConfig &config) {
+    config.windowSize = (int)linkPar("WS");
+    config.timeout = linkPar("TO").doubleValue();
+    config.processingTime = linkPar("PT").doubleValue();
+    config.transmissionDelay = linkPar("TD").doubleValue();
+    config.errorDelay = linkPar("ED").doubleValue();
+    config.duplicationDelay = linkPar("DD").doubleValue();
+    config.ackLossProb = linkPar("LP").doubleValue();
+    config.sequenceBits = (int)linkPar("SN");
+    config.datarate = linkPar("DR").doubleValue();
+    config.propagationDelay = linkPar("PD").doubleValue();
+    config.queueLimit = (int)linkPar("QL");
+    config.mtu = (int)linkPar("MTU");
+    config.aggregationLimit = (int)linkPar("AG");
+    config.readAhead = (int)linkPar("RA");
+    config.compression = linkPar("LZ").boolValue();
+    config.fec = (int)linkPar("FEC");
+    config.checksum = (int)linkPar("CS");
+    config.gapAcks = (int)linkPar("GA");
+    config.gapAckInterval = linkPar("GI").doubleValue();
+    config.bitErrorRate = linkPar("BER").doubleValue();
+    config.goodToBadProb = linkPar("GB").doubleValue();
+    config.badToGoodProb = linkPar("BG").doubleValue();
+    config.goodLossProb = linkPar("LG").doubleValue();
+    config.badLossProb = linkPar("LB").doubleValue();
+    config.randomDuplicationProb = linkPar("DP").doubleValue();
+    config.reorderProb = linkPar("RP").doubleValue();
+    config.errorRng = (int)linkPar("ER");
+    config.deliveryOutput = linkPar("DO").stdstringValue();
+    config.Validate();
+}
+
+Node::~Node()
+{
+    delete protocol;
+    delete input;
+    delete peerInput;
 }
 
-bool Node::sendDataFrame(int lineNumber, int dataSequenceNumber, bool errorFree, float &realTime, bool timeout=false) {
-
-    std::string line;
-
-    ReadLineResult r = this->input->ReadNthLine(lineNumber, line);
-    if (!r.moreLinesToRead) return false;
-
-    vecBitset8 payload = ConvertStringToBits(line.substr(5), true);
-
-    CustomMessage_Base* msgToSend = new CustomMessage_Base();
-    msgToSend->setFrameType(DELAYED_DATA_FRAME);
-    msgToSend->setParity(CalculateChecksum(payload));
-    msgToSend->setDataSequence(dataSequenceNumber);
-
-    realTime = this->getRealTime(&this->senderInfo.delayedMessages);
-    this->log("At time [%.3f], Node [%d], Introducing channel error with code = [%s]", realTime, this->id, line.substr(0,4).c_str());
-
-    bool lost = false, duplicated = false;
-    int modifiedBit = -1;
-    float errorDelay = 0;
-
-    // Applying errors..
-    if (!errorFree) {
-
-        // Modification
-        std::bitset<4> errorPrefix(line.substr(0, 4));
-        if (errorPrefix.test(3)) modifiedBit = this->modifyPayload(payload);
-
-        // Loss
-        lost = errorPrefix.test(2);
-
-        // Duplication
-        duplicated = errorPrefix.test(1);
-
-        // Delay
-        if (errorPrefix.test(0)) errorDelay = Info::errorDelay;
-    }
-
-    if (!timeout && errorFree) errorDelay += 0.001;
-    msgToSend->setPayload(payload);
-
-    float processingTime = (int)!r.readFromBuffer * Info::processingTime;
-    realTime = this->insertIntoDelayed(&this->senderInfo.delayedMessages, msgToSend, lost, processingTime, errorDelay);
-
-    scheduleAt(realTime, msgToSend);
-
-    // Log output
-    this->log("At time [%.3f], Node [%d] [sent] frame with seq_num = [%d] and payload = [%s] and trailer = [%s], Modified [%d], Lost [%s], Duplicate [%d], Delay [%.3f]",
-            realTime, this->id, dataSequenceNumber, ConvertBitsToString(payload).c_str(),
-            msgToSend->getParity().to_string().c_str(), modifiedBit, lost? "Yes": "No", (int)duplicated, errorDelay);
-
-    // If duplicated, send a duplicate message with the duplication delay.
-    if (duplicated) {
-        CustomMessage_Base* duplicatedMsg = msgToSend->dup();
-        this->insertIntoDelayed(&this->senderInfo.delayedMessages, duplicatedMsg, lost, 0, Info::duplicationDelay + errorDelay);
-        this->log("At time [%.3f], Node [%d] [sent] frame with seq_num = [%d] and payload = [%s] and trailer = [%s], Modified [%d], Lost [%s], Duplicate [%d], Delay [%.3f]",
-                realTime, this->id, dataSequenceNumber, ConvertBitsToString(payload).c_str(),
-                msgToSend->getParity().to_string().c_str(), modifiedBit, lost? "Yes": "No", 2, errorDelay);
-        // if (lost) delete duplicatedMsg;
-        scheduleAt(realTime, duplicatedMsg);
-    }
+void Node::getInitializationInfo(CustomMessage_Base* msg) {
+    std::istringstream iss(ConvertBitsToString(*msg->getPayload()));
+    int startingNodeID;
+    float startingTime;
 
-    //if (lost) delete msgToSend;
-    //else sendDelayed(msgToSend, delay + errorDelay, "peer$o");
+    if ( !(iss >> startingNodeID >> startingTime) )
+        throw std::runtime_error("Invalid format of the coordinator message payload");
 
-    return true;
+    this->protocol->start(startingNodeID, startingTime);
 }
 
-Timer* Node::createTimer(int ackSequence) {
-    Timer* timer = NULL;
-    if (!this->senderInfo.timers) {
-        this->senderInfo.timers = new Timer();
-        timer = this->senderInfo.timers;
-    }
-    else {
-        Timer* t = this->senderInfo.timers;
-        while (t) {
-            if (!t->next) break;
-            t = t->next;
-        }
-        t->next = new Timer();
-        timer = t->next;
-        timer->prev = t;
-    }
-    timer->msg = new CustomMessage_Base();
-    timer->msg->setAckSequence(ackSequence);
-    return timer;
+double Node::getTime() {
+    return simTime().dbl();
 }
 
-Timer* Node::deleteTimers(int ackSequence, bool prev) {
-
-    Timer* t = this->senderInfo.timers;
-
-    while (t) {
-        if (t->msg->getAckSequence() == this->modulus(ackSequence))
-            break;
-        t = t->next;
-    }
-
-    if (t) {
-
-        if (prev) {
-            this->senderInfo.timers = t->next;
-            if (this->senderInfo.timers) this->senderInfo.timers->prev = NULL;
-        } else {
-            if (t->prev) t->next = NULL;
-            else this->senderInfo.timers = NULL;
-        }
-
-        Timer* temp;
-        while (t) {
-            temp = prev ? t->prev : t->next;
-            cancelAndDelete(t->msg);
-            delete t;
-            t = temp;
-        }
-    }
-
-    return this->senderInfo.timers;
+void Node::schedule(double time, Frame* frame) {
+    FrameMessage* msg = new FrameMessage(frame);
+    frame->handle = msg;
+    scheduleAt(time, msg);
 }
 
-// prev is true on ack, false on nack
-void Node::advanceWindowAndSendFrames(int ackSequence, bool prev) {
-
-    int oldWStart = this->senderInfo.wStart;
-
-    // Updating wCurrent with the (n)ack sequence number.
-    // This will be the sequence number of the next frame to send.
-    this->senderInfo.wStart = ackSequence;
-
-    // Updating the line offset with the difference that we advanced wCurrent with.
-    this->senderInfo.currentLineOffset += this->modulus(this->senderInfo.wStart - oldWStart);
-
-    // Canceling the timeout for this acknowledgment.
-    // In case of ack: the timers for the preceding frames.
-    // In case of nack: the timers of all frames (the preceding are acknowledged, and the following are resent)
-    // and all the timeouts for ack preceding/following this one (accumulative n(ack))
-    int startingSeq = prev ? this->modulus(ackSequence - 1) : this->senderInfo.timers->msg->getAckSequence();
-    this->deleteTimers(startingSeq, prev);
-
-    // Advancing wCurrent and sending new frames as much as our window can expand.
-    float realTime = 0.0;
-    bool errorFree = prev ? false : true; // errorFree is true for the first message to be sent in case of nack.
-
-    int framesToSend = Info::windowSize - this->modulus(this->senderInfo.wCurrent - this->senderInfo.wStart);
-
-    // Log output
-    if (prev)
-        this->log("At time [%.3f], Node [%d] received ack with seq_num = [%d]. Advancing window and sending %d frames.", simTime().dbl(), this->id,
-                ackSequence, framesToSend);
-    else
-        this->log("At time [%.3f], Node [%d] received nack with seq_num = [%d]. Resending %d frames, starting from seq_num = [%d]", simTime().dbl(), this->id,
-                ackSequence, framesToSend, this->senderInfo.wCurrent);
-
-
-    for (int i = framesToSend; i > 0; i--) {
-
-        int lineNumber = this->senderInfo.currentLineOffset + this->modulus(this->senderInfo.wCurrent - this->senderInfo.wStart);
-        int dataSequenceNumber = this->senderInfo.wCurrent;
-        if (!this->sendDataFrame(lineNumber, dataSequenceNumber, errorFree, realTime)) {
-            this->log("At time [%.3f], Node [%d] found no more lines to send. Checking if we should terminate now", simTime().dbl(), this->id);
-            this->checkTermination();
-            this->log("At time [%.3f], Node [%d] is waiting for outstanding acks to terminate.", simTime().dbl(), this->id);
-            return;
-        }
-
-        // Setting errorFree to false in case of nack.
-        // Increasing the delay by 0.001 as per the document.
-        if (errorFree) errorFree = false;
-
-        // Create a timer
-        Timer* timer = this->createTimer(dataSequenceNumber);
-        scheduleAt( realTime + Info::timeout, timer->msg);
-        this->senderInfo.wCurrent = this->modulus(this->senderInfo.wCurrent + 1);
-    }
-
-    return;
+void Node::cancel(Frame* frame) {
+    if (frame->handle) cancelAndDelete((FrameMessage*)frame->handle);
+    else delete frame;
 }
 
-void Node::sender(CustomMessage_Base *msg) {
-
-    // If this is a self-message: either this is the initial self-message
-    // or this is a timeout. Either case, start sending all messages again that fall
-    // within the window.
-    if (msg->isSelfMessage()) {
-
-        if (msg->getFrameType() == DELAYED_DATA_FRAME) {
-            DelayedMessage* m = GetElementFromLinkedList<DelayedMessage, CustomMessage_Base*>(&this->senderInfo.delayedMessages, msg);
-
-            if (!m->lost) {
-                msg->setFrameType(msg->getFrameType() - DELAY_OFFSET);
-                sendDelayed(msg, Info::transmissionDelay + m->extraDelay, "peer$o");
-            }
-            DeleteElementFromLinkedList<DelayedMessage, CustomMessage_Base*>(&this->senderInfo.delayedMessages, msg);
-            return;
-        }
+void Node::sendToPeer(Frame* frame, double delay) {
+    CustomMessage_Base* msg = new CustomMessage_Base();
+    msg->setDataSequence(frame->dataSequence);
+    msg->setPayload(frame->payload);
+    msg->setParity(frame->parity);
+    msg->setFrameType(frame->frameType);
+    msg->setAckSequence(frame->ackSequence);
+    msg->setMoreFragments(frame->moreFragments);
+    msg->setFragmentLine(frame->fragmentLine);
+    msg->setFragmentIndex(frame->fragmentIndex);
+    if (frame->bitLength) msg->setBitLength(frame->bitLength);
+    delete frame;
 
-        int timedoutSequenceNumber = msg->getAckSequence();
-        if (timedoutSequenceNumber != -1) this->log("At time [%.3f], Node [%d] timeout event for frame with seq_num = [%d]", simTime().dbl(), this->id, timedoutSequenceNumber);
-
-        // Cancel all timers starting from the timer that expired and onwards, i.e: all timers.
-        // Clarification: if a timer expired, it MUST have been the first timer in the window, by the very
-        // structure of the way acknowledgements are serially handled in the code.
-        if (this->senderInfo.timers) this->deleteTimers(this->senderInfo.timers->msg->getAckSequence(), false);
-
-        int dataSequenceNumber, lineNumber;
-        float realTime; bool errorFree = false;
-        for (int i = 0; i < Info::windowSize; i++) {
-
-            dataSequenceNumber =  this->modulus(this->senderInfo.wStart + i);
-            lineNumber = this->senderInfo.currentLineOffset + i;
-            errorFree = false;
-
-            // If this is the message that caused the timeout, then send it error-free.
-            if (dataSequenceNumber == timedoutSequenceNumber) errorFree = true;
-
-            if (!this->sendDataFrame(lineNumber, dataSequenceNumber, errorFree, realTime, true))
-                return this->checkTermination();
-
-            Timer* timer = this->createTimer(dataSequenceNumber);
-            scheduleAt( realTime + Info::timeout, timer->msg);
-        }
-
-        senderInfo.wCurrent = this->modulus(senderInfo.wStart + Info::windowSize);
-    }
-
-    // We received an ACK or NACK.
-    else {
-        int sequenceNumber = msg->getAckSequence();
-        switch (msg->getFrameType()) {
-        case ACK_FRAME: {
-            this->advanceWindowAndSendFrames(sequenceNumber, true);
-            break;
-        }
-
-        case NACK_FRAME: {
-            this->senderInfo.wCurrent = sequenceNumber;
-            this->advanceWindowAndSendFrames(sequenceNumber, false);
-            break;
-        }
-
-        default: break;
-        }
-
-        cancelAndDelete(msg);
-    }
+    sendDelayed(msg, delay, "peer$o");
 }
 
-void Node::checkTermination() {
-    if (this->senderInfo.wStart == this->senderInfo.wCurrent) {
-        this->log("At time [%.3f], Node [%d] finished sending and receiving acks.", simTime().dbl(), this->id);
-        exit(0);
-    }
+double Node::uniformRandom(double a, double b, int rng) {
+    return uniform(a, b, rng);
 }
 
-double Node::getRealTime(linkedList<DelayedMessage> *l) {
-
-    // Calculating the supposed delay in processing times
-    double realTime;
-    if (!l->end) realTime = simTime().dbl();
-    else realTime = simTime().dbl() >= l->end->realTime ? simTime().dbl() : l->end->realTime;
-
-    return realTime;
+int Node::intuniformRandom(int a, int b, int rng) {
+    return intuniform(a, b, rng);
 }
 
-double Node::insertIntoDelayed(linkedList<DelayedMessage> *l, CustomMessage_Base* msg, bool lost, double processingTime, double extraDelay) {
+void Node::writeLog(const char* line, size_t length) {
+    this->log->write(line, length) << std::endl;
 
-    // Calculating the supposed delay in processing times
-    double realTime = this->getRealTime(l) + processingTime;
-
-    InsertAtEndOfLinkedList<DelayedMessage, CustomMessage_Base*>(l);
-    l->end->N = msg;
-    l->end->simTime = simTime().dbl();
-    l->end->realTime = realTime;
-    l->end->extraDelay = extraDelay;
-    l->end->lost = lost;
-
-    return realTime;
+    EV << line << std::endl;
 }
 
-void Node::sendAck(int ACK_TYPE, bool LP) {
-
-    bool lost = false;
-
-    CustomMessage_Base* ack = new CustomMessage_Base();
-    ack->setFrameType(ACK_TYPE + DELAY_OFFSET);
-    ack->setAckSequence(this->receiverInfo.expectedFrameSequence);
-
-    if ((uniform(0,1) <= Info::ackLossProb) && LP) lost = true;
-    double realTime = this->insertIntoDelayed(&this->receiverInfo.delayedMessages, ack, lost, Info::processingTime);
+void Node::recordResult(const char* name, double value) {
+    recordScalar(name, value);
+}
 
-    this->log("At time [%.3f], Node [%d] sending [%s] with number [%d], loss [%s]", realTime, this->id,
-            ACK_TYPE ? "ACK" : "NACK", ack->getAckSequence(), lost? "Yes" : "No");
+void Node::endRun() {
+    this->finished = true;
+}
 
-    if (lost) delete ack;
-    else scheduleAt(realTime, ack);
+void Node::finish()
+{
+    this->protocol->finish();
 
+#ifdef GBN_PROFILE
+    std::ostringstream profile;
+    this->protocol->profiler.dump(profile, this->getName());
+    EV << profile.str();
+#endif
 }
 
-void Node::receiver(CustomMessage_Base *msg) {
+void Node::handleMessage(cMessage *msg)
+{
+    PROFILE_EVENT();
+    PROFILE_SCOPE(PROF_HANDLE_MESSAGE);
 
-    // If this is a delayed ack or nack
+    // A frame scheduled by the protocol.
     if (msg->isSelfMessage()) {
-        DelayedMessage* m = GetElementFromLinkedList<DelayedMessage, CustomMessage_Base*>(&this->receiverInfo.delayedMessages, msg);
-        if (!m->lost) {
-            msg->setFrameType(msg->getFrameType() - DELAY_OFFSET);
-            sendDelayed(msg, Info::transmissionDelay + m->extraDelay, "peer$o");
-        }
-        DeleteElementFromLinkedList<DelayedMessage, CustomMessage_Base*>(&this->receiverInfo.delayedMessages, msg);
-        return;
-    }
-
-    // If not an in-order message, drop and send an ack with the sequence of the next expected frame sequence.
-    if (msg->getDataSequence() != this->receiverInfo.expectedFrameSequence) {
-        this->log("At time [%.3f], Node [%d] dropped out-of-order frame with seq_num = [%d]. Expecting seq_num = [%d]", this->getRealTime(&this->receiverInfo.delayedMessages), this->id, msg->getDataSequence(), this->receiverInfo.expectedFrameSequence);
-        this->sendAck(ACK_FRAME, false);
-        cancelAndDelete(msg);
+        FrameMessage* frameMsg = check_and_cast<FrameMessage*>(msg);
+        Frame* frame = frameMsg->frame;
+        frameMsg->frame = NULL;
+        frame->handle = NULL;
+        delete frameMsg;
+        this->protocol->handleFrame(frame, true);
+
+        // The protocol unwinds before the simulation ends, so that finish() sees its final state.
+        if (this->finished) endSimulation();
         return;
     }
 
-    // Verify the checksum of the message
-    bool valid = VerifyChecksum(*(msg->getPayload()), msg->getParity());
-    this->receiverInfo.expectedFrameSequence += valid ? 1 : 0;
-    this->receiverInfo.expectedFrameSequence = this->modulus(this->receiverInfo.expectedFrameSequence);
-
-    if (valid) this->log("Uploading payload = \"%s\" At time [%.3f] and seq_num = [%d] to the network layer", ConvertBitsToString(*(msg->getPayload()), true).c_str(), this->getRealTime(&this->receiverInfo.delayedMessages), msg->getDataSequence());
-    this->sendAck(int(valid));
-
-    cancelAndDelete(msg);
-    return;
-}
-
-void Node::handleMessage(cMessage *msg)
-{
     CustomMessage_Base* customMsg = check_and_cast<CustomMessage_Base *>(msg);
 
     // If this is the (initial) coordinator message
@@ -418,8 +189,18 @@ void Node::handleMessage(cMessage *msg)
         return;
     }
 
-    // Call the appropriate function
-    if (this->isSender) this->sender(customMsg);
-    else this->receiver(customMsg);
-
+    // A frame from the peer.
+    Frame* frame = new Frame();
+    frame->dataSequence = customMsg->getDataSequence();
+    frame->payload = *customMsg->getPayload();
+    frame->parity = customMsg->getParity();
+    frame->frameType = customMsg->getFrameType();
+    frame->ackSequence = customMsg->getAckSequence();
+    frame->moreFragments = customMsg->getMoreFragments();
+    frame->fragmentLine = customMsg->getFragmentLine();
+    frame->fragmentIndex = customMsg->getFragmentIndex();
+    delete msg;
+
+    this->protocol->handleFrame(frame, false);
+    if (this->finished) endSimulation();
 }
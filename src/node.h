@@ -20,126 +20,74 @@
 #include <fstream>
 #include "CustomMessage_m.h"
 #include "util.h"
+#include "protocol.h"
 using namespace omnetpp;
 
-// Doubly-linked list node for the timers.
-struct Timer {
-    CustomMessage_Base* msg = NULL;
-    Timer* next = NULL;
-    Timer* prev = NULL;
-};
-
-struct DelayedMessage {
-    CustomMessage_Base* N = NULL;
-    double simTime = 0;
-    double realTime = 0;
-    DelayedMessage* next = NULL;
-    DelayedMessage* prev = NULL;
-    bool lost = false;
-    double extraDelay = 0;
-};
-
-struct SenderInfo {
-
-    // Sequence number of the start of the window.
-    int wStart = 0;
-
-    // The next sequence number to be sent.
-    int wCurrent = 0;
-
-    // The line number in the text file corresponding to the
-    // current wStart.
-    int currentLineOffset = 0;
-
-    // The starting time the sender should start sending frames.
-    // Received from the coordinator.
-    float startingTime = 0.0;
-
-    // This is a vector of self-messages, acting as timeouts.
-    Timer* timers = NULL;
-
-    linkedList<DelayedMessage> delayedMessages;
-};
-
-struct ReceiverInfo {
-
-    // The next expected frame sequence.
-    int expectedFrameSequence = 0;
+// The self-message a scheduled frame rides on. It owns the frame until the frame is
+// handed back to the protocol, so frames still pending when the run ends are freed with it.
+class FrameMessage : public cMessage
+{
+  public:
+    Frame* frame;
 
-    linkedList<DelayedMessage> delayedMessages;
+    FrameMessage(Frame* frame) : cMessage("frame"), frame(frame) {}
+    virtual ~FrameMessage() { delete frame; }
 };
 
-class Node : public cSimpleModule
+// The OMNeT++ module of a node. The Go-Back-N logic lives in Protocol; the module
+// is its Scheduler, mapping frames onto OMNeT++ messages, timers and RNGs.
+class Node : public cSimpleModule, public Scheduler
 {
   protected:
     virtual void initialize();
     virtual void handleMessage(cMessage *msg);
+    virtual void finish();
 
     // Handles the initial message from the coordinator, and sets
     // the relevant data members accordingly.
     virtual void getInitializationInfo(CustomMessage_Base* msg);
 
-    // Main function of the sender node.
-    virtual void sender(CustomMessage_Base *msg);
-
-    // Main function of the receiver node.
-    virtual void receiver(CustomMessage_Base *msg);
-
-    // Checks if the sender should terminate operation: when there is no more outstanding
-    // frames. Called in sendDataFrame() below when there is no more lines to read from the file.
-    virtual void checkTermination();
+    // Reads the parameters of the link of the node and validates them.
+    virtual void readConfig(LinkConfig &config);
 
-    // Sends a data frame with payload = the line with the given line number in the text
-    // file, the sequence number of the frame to be sent, whether it should be errorFree,
-    // calculates the delay and returns it in the parameter delay.
-    // Returns true if there was more lines to read from the file, and a frame was successfully sent,
-    // false otherwise.
-    virtual bool sendDataFrame(int lineNumber, int dataSequenceNumber, bool errorFree, float &realTime, bool timeout);
+    // The link parameter of the given name: the node's own, if its module type
+    // declares it, or otherwise the network's.
+    cPar& linkPar(const char* name);
 
-    // Sends an ACK/NACK, applying the ack loss probability if LP = true
-    //
-    virtual void sendAck(int ACK_TYPE, bool LP = true);
+  public:
+    virtual ~Node();
 
-    // Performs mod operation that is valid for
-    // negative numbers as well as positive numbers.
-    virtual int modulus(int a);
+    // Scheduler
+    virtual double getTime() override;
+    virtual void schedule(double time, Frame* frame) override;
+    virtual void cancel(Frame* frame) override;
+    virtual void sendToPeer(Frame* frame, double delay) override;
+    virtual double uniformRandom(double a, double b, int rng = 0) override;
+    virtual int intuniformRandom(int a, int b, int rng = 0) override;
+    virtual bool isLogEnabled() const override { return true; }
+    virtual void writeLog(const char* line, size_t length) override;
+    virtual void recordResult(const char* name, double value) override;
+    virtual void endRun() override;
 
-    // Modifies a random bit in the payload in place, and returns the
-    // position of modified bit.
-    virtual int modifyPayload(vecBitset8 &payload);
+    // The protocol of the node, or NULL before the coordinator's message arrives.
+    const Protocol* getProtocol() const { return protocol; }
 
-    // Creates a timer with the given ackSequence number, inserts it into
-    // the doubly-linked list of timers and returns it.
-    virtual Timer* createTimer(int ackSequence);
-
-    // Deletes a timer with the given ackSequence number, and removes it from
-    // the doubly-linked list, and all timers after or before it.
-    // Returns the head of the linked list after deletion of timers.
-    virtual Timer* deleteTimers(int ackSequence, bool prev);
-
-    // On receiving an ack/nack sequence at the sender, calculates and advances
-    // the window and sends new frames.
-    virtual void advanceWindowAndSendFrames(int ackSequence, bool prev);
-
-    // Logs the given printf-style string and format to omnte++ simulation stdout,
-    // and the log file `output.txt`
-    template<typename... Args> void log(const char * f, Args... args);
-
-    virtual double insertIntoDelayed(linkedList<DelayedMessage> *l, CustomMessage_Base* msg, bool lost, double processingTime, double extraDelay=0);
-    virtual double getRealTime(linkedList<DelayedMessage> *l);
   private:
 
     // The id of the node.
     int id;
 
-    // The input text file of the node.
-    TextFile *input;
+    // The input text file of the node, and that of its peer when delivery is checked.
+    TextFile *input = NULL;
+    TextFile *peerInput = NULL;
+
+    // The log of the network, owned by the coordinator.
+    std::ostream *log = NULL;
 
-    // Whether the node is the sender.
-    bool isSender = false;
+    Protocol *protocol = NULL;
 
-    struct SenderInfo senderInfo;
-    struct ReceiverInfo receiverInfo;
+    // Set by endRun(), so that the simulation ends once the current event is handled.
+    bool finished = false;
 };
 
 #endif
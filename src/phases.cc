@@ -0,0 +1,80 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include "phases.h"
+
+std::string PhaseAction::command() const
+{
+    return this->value.empty() ? this->name : this->name + " " + this->value;
+}
+
+bool IsRuntimeParameter(const std::string &name)
+{
+    static const char* const names[] = {
+        "WS", "TO", "PT", "TD", "ED", "DD", "LP", "DR", "PD",
+        "BER", "GB", "BG", "LG", "LB", "DP", "RP",
+    };
+    for (const char* n : names)
+        if (name == n) return true;
+    return false;
+}
+
+std::vector<PhaseAction> ReadPhaseScript(std::istream &in)
+{
+    std::vector<PhaseAction> actions;
+    std::string line;
+
+    // The line numbers follow the starting info, which the caller has read.
+    for (int lineNumber = 2; std::getline(in, line); lineNumber++) {
+        std::istringstream tokens(line.substr(0, line.find('#')));
+        std::string time, node;
+        if (!(tokens >> time)) continue;
+
+        PhaseAction action;
+        std::string where = "Phase script line " + std::to_string(lineNumber) + ": ";
+        char* end;
+        action.time = strtod(time.c_str(), &end);
+        if (*end || action.time < 0)
+            throw std::runtime_error(where + "bad time " + time);
+
+        if (!(tokens >> node >> action.name))
+            throw std::runtime_error(where + "expected <time> <node|*> <action> [value]");
+        if (node == "*") action.node = -1;
+        else if (node == "0" || node == "1") action.node = node[0] - '0';
+        else throw std::runtime_error(where + "the node must be 0, 1 or *");
+
+        if (action.name == "stop" || action.name == "start") {
+            if (tokens >> action.value)
+                throw std::runtime_error(where + action.name + " takes no value");
+        }
+        else {
+            if (!IsRuntimeParameter(action.name))
+                throw std::runtime_error(where + action.name + " cannot change during a run");
+            if (!(tokens >> action.value))
+                throw std::runtime_error(where + "no value for " + action.name);
+            strtod(action.value.c_str(), &end);
+            if (*end) throw std::runtime_error(where + "bad value " + action.value);
+        }
+        actions.push_back(action);
+    }
+
+    std::stable_sort(actions.begin(), actions.end(),
+            [](const PhaseAction &a, const PhaseAction &b) { return a.time < b.time; });
+    return actions;
+}
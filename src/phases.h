@@ -0,0 +1,56 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef PHASES_H_
+#define PHASES_H_
+
+#include <istream>
+#include <string>
+#include <vector>
+
+// One action of the coordinator's phase script: at the given time, a control frame
+// tells one node, or both, to change a parameter or to stop or start sending new data.
+struct PhaseAction {
+    double time = 0;
+
+    // The node the action is sent to, or -1 for both.
+    int node = -1;
+
+    // A parameter that can change during a run (see IsRuntimeParameter) and its new
+    // value, or "stop" or "start" without a value.
+    std::string name;
+    std::string value;
+
+    // The payload of the control frame, "name value".
+    std::string command() const;
+};
+
+// Whether the parameter with the given NED name can change during a run: the window
+// size (within the sequence space), the timing and delay parameters, the ack loss
+// probability, the link model and the stochastic error model.
+bool IsRuntimeParameter(const std::string &name);
+
+// Reads the phase script that follows the starting info in the coordinator file, one
+// action per line:
+//
+//   <time> <node|*> <parameter> <value>
+//   <time> <node|*> stop|start
+//
+// Blank lines and # comments are skipped. The actions are returned in time order,
+// those at the same time in the order of the script. Throws std::runtime_error naming
+// the line of a malformed action.
+std::vector<PhaseAction> ReadPhaseScript(std::istream &in);
+
+#endif /* PHASES_H_ */
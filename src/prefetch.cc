@@ -0,0 +1,101 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include <algorithm>
+#include "prefetch.h"
+
+LinePrefetcher::LinePrefetcher(const std::string &fileName, const std::vector<std::streampos> &lineBeginnings,
+        int first, int capacity)
+    : fileName(fileName), lineBeginnings(lineBeginnings), slots(std::max(capacity, 1)), demand(first)
+{
+    this->worker = std::thread(&LinePrefetcher::run, this, first);
+}
+
+LinePrefetcher::~LinePrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping.store(true);
+    }
+    this->wake.notify_one();
+    this->worker.join();
+}
+
+void LinePrefetcher::run(int first) {
+    std::ifstream in(this->fileName, std::ios::binary);
+    if (!in.is_open()) return;
+    int lineCount = (int)this->lineBeginnings.size() - 1;
+    int next = first;
+    bool positioned = false;
+
+    while (!this->stopping.load(std::memory_order_relaxed)) {
+        int wanted = this->demand.load(std::memory_order_relaxed);
+        if (wanted > next) {
+            next = wanted;
+            positioned = false;
+        }
+
+        // Nothing is left to read; the consumer reads anything it goes back for itself.
+        if (next >= lineCount) return;
+
+        uint64_t t = this->tail.load(std::memory_order_relaxed);
+        if (t - this->head.load(std::memory_order_acquire) == this->slots.size()) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wake.wait(lock, [this, t] {
+                return this->stopping.load() || t - this->head.load(std::memory_order_acquire) < this->slots.size();
+            });
+            continue;
+        }
+
+        // The same reads as TextFile::ReadLineFromSource.
+        Slot &slot = this->slots[t % this->slots.size()];
+        if (!positioned) {
+            in.clear();
+            in.seekg(this->lineBeginnings[next]);
+        }
+        std::getline(in, slot.line);
+        positioned = (std::streamoff)this->lineBeginnings[next] + (std::streamoff)slot.line.size() + 1 == (std::streamoff)this->lineBeginnings[next + 1];
+        if (!slot.line.empty()) slot.line.pop_back();
+        slot.N = next++;
+
+        this->tail.store(t + 1, std::memory_order_release);
+    }
+}
+
+bool LinePrefetcher::take(int N, std::string &s) {
+    uint64_t h = this->head.load(std::memory_order_relaxed);
+    uint64_t t = this->tail.load(std::memory_order_acquire);
+    bool full = t - h == this->slots.size();
+
+    while (h != t && this->slots[h % this->slots.size()].N < N) h++;
+    bool hit = h != t && this->slots[h % this->slots.size()].N == N;
+    if (hit) {
+        s.swap(this->slots[h % this->slots.size()].line);
+        h++;
+        this->hits++;
+    }
+    else this->misses++;
+
+    bool freed = h != this->head.load(std::memory_order_relaxed);
+    this->head.store(h, std::memory_order_release);
+    if (N + 1 > this->demand.load(std::memory_order_relaxed)) this->demand.store(N + 1, std::memory_order_relaxed);
+
+    // The worker sleeps only on a full ring. Taking the mutex orders the wakeup after its
+    // check of the ring, so that it cannot be missed; the ring itself is never locked.
+    if (full && freed) {
+        { std::lock_guard<std::mutex> lock(this->mutex); }
+        this->wake.notify_one();
+    }
+    return hit;
+}
@@ -0,0 +1,79 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef PREFETCH_H_
+#define PREFETCH_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reads the lines of an input file ahead of the simulation on a worker thread, in order,
+// into a ring of a fixed number of lines. The ring has a single producer (the worker) and
+// a single consumer (the thread reading the TextFile), and neither locks it: the consumer
+// takes a line if it is ready and reads it from disk itself otherwise, so it never waits
+// for the worker. The worker sleeps while the ring is full and ends once the file is read.
+// Lines are read exactly as TextFile reads them from disk.
+class LinePrefetcher {
+    struct Slot {
+        int N = 0;
+        std::string line;
+    };
+
+    std::string fileName;
+    std::vector<std::streampos> lineBeginnings;
+    std::vector<Slot> slots;
+
+    // The number of lines taken out of the ring and put into it so far; the slot of a
+    // count is count % slots.size().
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+
+    // The line the consumer is going to ask for next, which the worker skips ahead to.
+    std::atomic<int> demand;
+    std::atomic<bool> stopping{false};
+
+    // Only for the worker to sleep on while the ring is full.
+    std::mutex mutex;
+    std::condition_variable wake;
+
+    std::thread worker;
+
+    void run(int first);
+public:
+    // Starts reading `capacity` lines ahead from line `first` of the file with the given
+    // index of line beginnings, as built by TextFile::OpenFile().
+    LinePrefetcher(const std::string &fileName, const std::vector<std::streampos> &lineBeginnings,
+            int first, int capacity);
+    LinePrefetcher(const LinePrefetcher&) = delete;
+    LinePrefetcher& operator=(const LinePrefetcher&) = delete;
+
+    // Stops the worker and waits for it.
+    ~LinePrefetcher();
+
+    // Moves the Nth line into `s` if it has been read ahead, dropping the lines before it.
+    // Returns false, without waiting, if it has not; the caller then reads it itself.
+    bool take(int N, std::string &s);
+
+    // Lines taken from the ring, and lines asked for that were not in it.
+    long hits = 0;
+    long misses = 0;
+};
+
+#endif /* PREFETCH_H_ */
@@ -0,0 +1,88 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include "profiler.h"
+
+#ifdef GBN_PROFILE
+
+#include <chrono>
+#include <cstdio>
+#if defined(GBN_PROFILE_RDTSC) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PROFILE_USE_RDTSC
+#endif
+
+thread_local Profiler* Profiler::current = nullptr;
+thread_local Profiler Profiler::kernel;
+thread_local uint64_t Profiler::lastEventEnd = 0;
+
+uint64_t Profiler::now() {
+#ifdef PROFILE_USE_RDTSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+const char* Profiler::sectionName(int section) {
+    static const char* names[] = {
+        "Node::handleMessage",
+        "TextFile::OpenFile",
+        "TextFile::ReadNthLine",
+        "TextFile::ReadLines",
+        "ConvertStringToBits",
+        "ConvertBitsToString",
+        "CalculateChecksum",
+        "VerifyChecksum",
+        "Node::prepareDataFrames",
+        "Node::sendDataFrames",
+        "Node::transmit",
+        "Node::log",
+        "Node::createTimer",
+        "Node::deleteTimers",
+        "PayloadCodec::compress",
+        "PayloadCodec::decompress",
+        "FecDecode",
+        "kernel (between events)",
+    };
+    return (section >= 0 && section < PROF_SECTION_COUNT) ? names[section] : "";
+}
+
+void Profiler::dump(std::ostream &out, const char* moduleName) const {
+
+#ifdef PROFILE_USE_RDTSC
+    const char* unit = "cycles";
+#else
+    const char* unit = "ns";
+#endif
+
+    // Sections are inclusive of the sections they call, so the shares are relative
+    // to the whole time spent handling events (or between them, for the kernel).
+    uint64_t total = this->counters[PROF_HANDLE_MESSAGE].ticks + this->counters[PROF_KERNEL].ticks;
+
+    char buffer[256];
+    out << "Profile of " << moduleName << ":" << std::endl;
+    for (int i = 0; i < PROF_SECTION_COUNT; i++) {
+        const ProfileCounter &c = this->counters[i];
+        if (!c.calls) continue;
+        snprintf(buffer, sizeof(buffer), "  %-26s %12llu calls %16llu %s %12.1f %s/call %6.2f%%",
+                sectionName(i), (unsigned long long)c.calls, (unsigned long long)c.ticks, unit,
+                (double)c.ticks / c.calls, unit, total ? 100.0 * c.ticks / total : 0.0);
+        out << buffer << std::endl;
+    }
+}
+
+#endif /* GBN_PROFILE */
@@ -0,0 +1,116 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+// Hot-path instrumentation: call counters and inclusive times of the sections below.
+// Only compiled in when GBN_PROFILE is defined (`make PROFILE=1`); otherwise the
+// macros expand to nothing. Times are steady_clock nanoseconds, or TSC cycles when
+// GBN_PROFILE_RDTSC is defined as well on x86.
+//
+// PROFILE_SCOPE(section)  => Times the rest of the enclosing scope into the current profiler.
+// PROFILE_EVENT()         => Marks the enclosing scope as the handling of one event, so the time
+//                            between events is attributed to the simulation kernel.
+
+#ifdef GBN_PROFILE
+
+#include <cstdint>
+#include <ostream>
+
+enum ProfileSection {
+    PROF_HANDLE_MESSAGE,
+    PROF_OPEN_FILE,
+    PROF_READ_NTH_LINE,
+    PROF_READ_LINES,
+    PROF_STRING_TO_BITS,
+    PROF_BITS_TO_STRING,
+    PROF_CALCULATE_CHECKSUM,
+    PROF_VERIFY_CHECKSUM,
+    PROF_PREPARE_FRAMES,
+    PROF_SEND_FRAMES,
+    PROF_TRANSMIT,
+    PROF_LOG,
+    PROF_CREATE_TIMER,
+    PROF_DELETE_TIMERS,
+    PROF_COMPRESS,
+    PROF_DECOMPRESS,
+    PROF_FEC_DECODE,
+    PROF_KERNEL,
+    PROF_SECTION_COUNT
+};
+
+struct ProfileCounter {
+    uint64_t calls = 0;
+    uint64_t ticks = 0;
+};
+
+class Profiler {
+public:
+    // The profiler of the module handling the current event, which the sections are counted into.
+    // Per thread, as are the kernel times, so that concurrent runs are profiled separately.
+    static thread_local Profiler* current;
+
+    // The time between events, spent in the simulation kernel.
+    static thread_local Profiler kernel;
+    static thread_local uint64_t lastEventEnd;
+
+    ProfileCounter counters[PROF_SECTION_COUNT];
+
+    static uint64_t now();
+    static const char* sectionName(int section);
+
+    // Writes the breakdown of the sections called at least once, as a share of the total event time.
+    void dump(std::ostream &out, const char* moduleName) const;
+};
+
+class ProfileScope {
+    ProfileSection section;
+    uint64_t start;
+public:
+    ProfileScope(ProfileSection section) : section(section), start(Profiler::now()) {}
+    ~ProfileScope() {
+        if (!Profiler::current) return;
+        ProfileCounter &c = Profiler::current->counters[section];
+        c.calls++;
+        c.ticks += Profiler::now() - start;
+    }
+};
+
+class ProfileEvent {
+public:
+    ProfileEvent() {
+        if (Profiler::lastEventEnd) {
+            ProfileCounter &c = Profiler::kernel.counters[PROF_KERNEL];
+            c.calls++;
+            c.ticks += Profiler::now() - Profiler::lastEventEnd;
+        }
+    }
+    ~ProfileEvent() { Profiler::lastEventEnd = Profiler::now(); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(section) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(section)
+#define PROFILE_EVENT() ProfileEvent PROFILE_CONCAT(profileEvent, __LINE__)
+
+#else
+
+#define PROFILE_SCOPE(section)
+#define PROFILE_EVENT()
+
+#endif /* GBN_PROFILE */
+
+#endif /* PROFILER_H_ */
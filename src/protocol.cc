@@ -0,0 +1,675 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include "protocolpaths.h"
+#include "phases.h"
+#include <stdio.h>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+// The floating point parameters phase actions can change (see IsRuntimeParameter),
+// which checkpoints keep along with the window size.
+static double LinkConfig::* const RUNTIME_PARAMETERS[] = {
+    &LinkConfig::timeout, &LinkConfig::processingTime, &LinkConfig::transmissionDelay,
+    &LinkConfig::errorDelay, &LinkConfig::duplicationDelay, &LinkConfig::ackLossProb,
+    &LinkConfig::datarate, &LinkConfig::propagationDelay, &LinkConfig::bitErrorRate,
+    &LinkConfig::goodToBadProb, &LinkConfig::badToGoodProb, &LinkConfig::goodLossProb,
+    &LinkConfig::badLossProb, &LinkConfig::randomDuplicationProb, &LinkConfig::reorderProb,
+};
+
+Protocol::Protocol(int id, const LinkConfig &config, Scheduler* scheduler, TextFile* input)
+    : id(id), config(config), scheduler(scheduler), input(input)
+{
+}
+
+Protocol::~Protocol()
+{
+    // Timer frames still scheduled are owned by the scheduler.
+    for (Timer* t = this->senderInfo.timers; t; ) {
+        Timer* next = t->next;
+        delete t;
+        t = next;
+    }
+}
+
+void Protocol::start(int startingNodeID, double startingTime) {
+
+    this->senderInfo.startingTime = startingTime;
+    this->errorModel.configure(this->config, this->scheduler);
+
+    if (startingNodeID == this->id) {
+        isSender = true;
+
+        // We only need to open the file if we are the sender.
+        this->input->OpenFile();
+        this->input->SetBufferSize(this->config.windowSize);
+        this->input->StartPrefetch(this->config.readAhead);
+
+        // Starting operation at the set starting time
+        Frame* initialMsg = new Frame();
+        initialMsg->frameType = START_FRAME;
+        this->scheduler->schedule(this->senderInfo.startingTime, initialMsg);
+    }
+    else if (!this->config.deliveryOutput.empty())
+        this->sink.reset(DeliverySink::create(this->config.deliveryOutput));
+    return;
+}
+
+seqnum Protocol::modulus(int64_t a) {
+    int64_t b = this->config.sequenceSpace;
+    return seqnum(((a % b) + b) % b);
+}
+
+seqnum Protocol::seqDistance(seqnum from, seqnum to) {
+    return this->modulus(int64_t(to) - int64_t(from));
+}
+
+bitset8 Protocol::checksum(vecBitset8 const &bytes) {
+    if (this->config.checksum == CHECKSUM_CRC8) return Crc8Checksum::compute(bytes);
+    return CalculateChecksum(bytes);
+}
+
+bool Protocol::verifyChecksum(vecBitset8 const &bytes, bitset8 const &parity) {
+    if (this->config.checksum == CHECKSUM_CRC8) return Crc8Checksum::compute(bytes) == parity;
+    return VerifyChecksum(bytes, parity);
+}
+
+int Protocol::modifyPayload(vecBitset8 &payload) {
+    if (payload.empty()) return -1;
+
+    // Both bounds of intuniformRandom() are included.
+    int bit = this->scheduler->intuniformRandom(0, (int)payload.size()*8 - 1);
+    payload[int(bit/8)][bit%8] = (~payload[int(bit/8)][bit%8]);
+    return bit;
+}
+
+DataUnit Protocol::unitAt(int d) {
+    std::deque<DataUnit> &window = this->senderInfo.window;
+    if (d < (int)window.size()) return window[d];
+
+    // Past the units in flight, only the unit right after them is known; any further
+    // ones are counted as whole, single lines.
+    DataUnit unit;
+    int beyond = d - (int)window.size();
+    if (window.empty()) {
+        unit.index = this->senderInfo.currentUnitOffset;
+        unit.line = this->senderInfo.currentLineOffset;
+        unit.fragment = this->senderInfo.currentFragment;
+    }
+    else {
+        const DataUnit &last = window.back();
+        unit.index = last.index + 1;
+        unit.line = last.last ? last.line + last.lines : last.line;
+        unit.fragment = last.last ? 0 : last.fragment + 1;
+        beyond--;
+    }
+    if (beyond > 0) {
+        unit.index += beyond;
+        unit.line += beyond;
+        unit.fragment = 0;
+    }
+    return unit;
+}
+
+void Protocol::sendDataFrame(int i, seqnum dataSequenceNumber, bool errorFree, float &realTime, bool timeout) {
+
+    FrameBatch &batch = this->senderInfo.batch;
+    const DataUnit &unit = batch.units[i];
+    vecBitset8 &payload = batch.payloads[i];
+
+    // A fragmented line takes its error code once, on its first fragment the first time
+    // it is sent; its other fragments and all their retransmissions are sent error-free.
+    static const std::string noErrors = "0000";
+    bool fragmented = unit.fragment > 0 || !unit.last;
+    const std::string &errorCode = fragmented && (unit.fragment > 0 || unit.index < this->senderInfo.nextNewUnit)
+            ? noErrors : batch.errorCodes[i];
+
+    Frame* msgToSend = new Frame();
+    msgToSend->frameType = DATA_FRAME;
+    msgToSend->parity = batch.parities[i];
+    msgToSend->dataSequence = (int)dataSequenceNumber;
+    msgToSend->moreFragments = !unit.last;
+    msgToSend->fragmentLine = (int)unit.line;
+    msgToSend->fragmentIndex = unit.fragment;
+
+    realTime = this->getRealTime(this->senderInfo.processedUntil);
+    this->log("At time [%.3f], Node [%d], Introducing channel error with code = [%s]", realTime, this->id, errorCode);
+
+    bool lost = false, duplicated = false;
+    int modifiedBit = -1;
+    float errorDelay = 0;
+
+    // Applying errors..
+    if (!errorFree) {
+
+        // Modification
+        std::bitset<4> errorPrefix(errorCode);
+        if (errorPrefix.test(3)) modifiedBit = this->modifyPayload(payload);
+
+        // Loss
+        lost = errorPrefix.test(2);
+
+        // Duplication
+        duplicated = errorPrefix.test(1);
+
+        // Delay
+        if (errorPrefix.test(0)) errorDelay = this->config.errorDelay;
+    }
+
+    // Stochastic channel errors, on top of the error codes.
+    ChannelErrors channel = this->errorModel.applyToFrame(payload);
+    lost = lost || channel.lost;
+    duplicated = duplicated || channel.duplicated;
+    if (modifiedBit == -1) modifiedBit = channel.firstModifiedBit;
+    errorDelay += channel.extraDelay;
+
+    if (!timeout && errorFree) errorDelay += 0.001;
+    msgToSend->payload = payload;
+
+    float processingTime = (int)batch.fromDisk[i] * this->config.processingTime;
+    realTime = this->queueForProcessing(this->senderInfo.processedUntil, processingTime);
+
+    // Log output, without the check bytes of FEC.
+    PayloadView shown(payload, this->config.fec ? FecDataBytes(payload.size()) : payload.size());
+    this->log("At time [%.3f], Node [%d] [sent] frame with seq_num = [%u] and payload = [%s] and trailer = [%s], Modified [%d], Lost [%s], Duplicate [%d], Delay [%.3f]",
+            realTime, this->id, dataSequenceNumber, shown,
+            BitsView(msgToSend->parity), modifiedBit, lost? "Yes": "No", (int)duplicated, errorDelay);
+
+    // If duplicated, send a duplicate message with the duplication delay.
+    // Lost frames are dropped before they are sent.
+    if (duplicated) {
+        this->log("At time [%.3f], Node [%d] [sent] frame with seq_num = [%u] and payload = [%s] and trailer = [%s], Modified [%d], Lost [%s], Duplicate [%d], Delay [%.3f]",
+                realTime, this->id, dataSequenceNumber, shown,
+                BitsView(msgToSend->parity), modifiedBit, lost? "Yes": "No", 2, errorDelay);
+    }
+    if (lost) {
+        delete msgToSend;
+        return;
+    }
+    Frame* duplicatedMsg = duplicated ? msgToSend->dup() : NULL;
+    this->transmit(msgToSend, realTime, errorDelay);
+    if (duplicatedMsg) this->transmit(duplicatedMsg, realTime, this->config.duplicationDelay + errorDelay);
+}
+
+Timer* Protocol::createTimer(seqnum ackSequence) {
+    PROFILE_SCOPE(PROF_CREATE_TIMER);
+    Timer* timer = NULL;
+    if (!this->senderInfo.timers) {
+        this->senderInfo.timers = new Timer();
+        timer = this->senderInfo.timers;
+    }
+    else {
+        Timer* t = this->senderInfo.timersEnd;
+        t->next = new Timer();
+        timer = t->next;
+        timer->prev = t;
+    }
+    this->senderInfo.timersEnd = timer;
+    timer->msg = new Frame();
+    timer->msg->ackSequence = (int)ackSequence;
+    return timer;
+}
+
+int Protocol::sendableFrames(const DataUnit &first, int count) const {
+    if (this->senderInfo.paused) count = std::min(count, this->senderInfo.nextNewUnit - first.index);
+    return std::max(count, 0);
+}
+
+void Protocol::control(const std::string &command) {
+    std::istringstream in(command);
+    std::string name, value;
+    in >> name >> value;
+
+    if (name == "stop" || name == "start") {
+        bool resuming = name == "start" && this->senderInfo.paused;
+        this->senderInfo.paused = name == "stop";
+        this->log("At time [%.3f], Node [%d] [control] %s sending new frames", this->scheduler->getTime(), this->id,
+                this->senderInfo.paused ? "stopped" : "started");
+
+        // Refilling the window; before the first frames, the start of the sender does it.
+        if (resuming && this->isSender && this->senderInfo.started) {
+            int inFlight = (int)this->seqDistance(this->senderInfo.wStart, this->senderInfo.wCurrent);
+            int framesToSend = std::max(this->config.windowSize - inFlight, 0);
+            if (framesToSend > 0) this->sendNewFrames(framesToSend, -1);
+        }
+        return;
+    }
+
+    // The sequence space stays that of the start of the run, so the window can only change within it.
+    LinkConfig changed = this->config;
+    if (!IsRuntimeParameter(name) || !SetLinkParameter(changed, name, value.c_str()))
+        throw std::runtime_error("The parameter " + name + " cannot change during a run.");
+    changed.Validate();
+    changed.sequenceSpace = this->config.sequenceSpace;
+    if (changed.windowSize >= changed.sequenceSpace)
+        throw std::runtime_error("The window size WS must stay smaller than the sequence space of the run; set SN for room to grow.");
+    this->config = changed;
+
+    this->errorModel.configure(this->config, this->scheduler);
+    if (this->isSender) this->input->SetBufferSize(this->config.windowSize);
+    this->log("At time [%.3f], Node [%d] [control] set %s = [%s]", this->scheduler->getTime(), this->id, name.c_str(), value.c_str());
+}
+
+void Protocol::sender(Frame *msg, bool self) {
+    this->sender(GenericCore{this}, msg, self);
+}
+
+void Protocol::sendNewFrames(int framesToSend, int errorFreeIndex) {
+    this->sendNewFrames(GenericCore{this}, framesToSend, errorFreeIndex);
+}
+
+bool Protocol::checkTermination() {
+    if (this->senderInfo.wStart == this->senderInfo.wCurrent) {
+        this->log("At time [%.3f], Node [%d] finished sending and receiving acks.", this->scheduler->getTime(), this->id);
+        this->scheduler->endRun();
+        return true;
+    }
+    return false;
+}
+
+double Protocol::getRealTime(double processedUntil) {
+    return std::max(this->scheduler->getTime(), processedUntil);
+}
+
+double Protocol::queueForProcessing(double &processedUntil, double processingTime) {
+
+    // Calculating the supposed delay in processing times
+    processedUntil = this->getRealTime(processedUntil) + processingTime;
+    return processedUntil;
+}
+
+long Protocol::frameBits(Frame* msg) {
+    // Header: data sequence, parity, frame type and ack sequence, and for fragments
+    // the line and the index of the fragment.
+    long headerBytes = sizeof(int) + 1 + 1 + sizeof(int);
+    if (msg->moreFragments || msg->fragmentIndex) headerBytes += 2 * sizeof(int);
+    return (headerBytes + (long)msg->payload.size()) * 8;
+}
+
+void Protocol::transmit(Frame* msg, double departure, double extraDelay) {
+    PROFILE_SCOPE(PROF_TRANSMIT);
+
+    // The time until the frame departs is part of its delay.
+    double wait = departure - this->scheduler->getTime();
+    if (this->config.datarate <= 0) {
+        this->scheduler->sendToPeer(msg, wait + this->config.transmissionDelay + extraDelay);
+        return;
+    }
+
+    // The transmit queue as the frame finds it when it departs; departures are in order.
+    double now = departure;
+    long bits = this->frameBits(msg);
+    msg->bitLength = bits;
+
+    // Frames that finished serialization have left the transmit queue.
+    while (!this->linkInfo.queue.empty() && this->linkInfo.queue.front() <= now)
+        this->linkInfo.queue.pop_front();
+
+    this->linkInfo.queueOccupancy.collect(this->linkInfo.queue.size());
+
+    if (this->config.queueLimit > 0 && (int)this->linkInfo.queue.size() >= this->config.queueLimit) {
+        this->log("At time [%.3f], Node [%d] dropped frame of type [%d] with %ld bits, transmit queue is full", now, this->id,
+                msg->frameType, bits);
+        this->linkInfo.framesDropped++;
+        delete msg;
+        return;
+    }
+
+    // Serialization starts once the transmitter is free, then the frame propagates.
+    this->linkInfo.busyUntil = std::max(now, this->linkInfo.busyUntil) + bits / this->config.datarate;
+    this->linkInfo.queue.push_back(this->linkInfo.busyUntil);
+    this->linkInfo.framesSent++;
+    this->linkInfo.bitsSent += bits;
+
+    this->scheduler->sendToPeer(msg, wait + this->linkInfo.busyUntil - now + this->config.propagationDelay + extraDelay);
+}
+
+void Protocol::sendAck(int ACK_TYPE, bool LP) {
+
+    bool lost = false;
+    this->receiverInfo.acksSent++;
+    if (ACK_TYPE == NACK_FRAME) this->receiverInfo.nacksSent++;
+
+    Frame* ack = new Frame();
+    ack->frameType = ACK_TYPE;
+    ack->ackSequence = (int)this->receiverInfo.expectedFrameSequence;
+
+    if ((this->scheduler->uniformRandom(0,1) <= this->config.ackLossProb) && LP) lost = true;
+
+    // Stochastic channel errors, on top of the ack loss probability.
+    ChannelErrors channel = this->errorModel.applyToControl(this->frameBits(ack));
+    lost = lost || channel.lost;
+
+    double realTime = this->queueForProcessing(this->receiverInfo.processedUntil, this->config.processingTime);
+
+    this->log("At time [%.3f], Node [%d] sending [%s] with number [%u], loss [%s]", realTime, this->id,
+            ACK_TYPE ? "ACK" : "NACK", (seqnum)ack->ackSequence, lost? "Yes" : "No");
+
+    if (channel.duplicated) {
+        this->log("At time [%.3f], Node [%d] sending duplicate [%s] with number [%u], loss [%s]", realTime, this->id,
+                ACK_TYPE ? "ACK" : "NACK", (seqnum)ack->ackSequence, lost? "Yes" : "No");
+    }
+
+    // Lost acks are dropped before they are sent.
+    if (lost) {
+        delete ack;
+        return;
+    }
+    Frame* duplicatedAck = channel.duplicated ? ack->dup() : NULL;
+    this->transmit(ack, realTime, channel.extraDelay);
+    if (duplicatedAck) this->transmit(duplicatedAck, realTime, this->config.duplicationDelay + channel.extraDelay);
+}
+
+void Protocol::receiver(Frame *msg) {
+    this->receiver(GenericCore{this}, msg);
+}
+
+void Protocol::discardReassembly() {
+    ReceiverInfo &r = this->receiverInfo;
+    if (r.reassemblyLine < 0) return;
+    this->log("At time [%.3f], Node [%d] discarded the partial line [%d]", this->getRealTime(r.processedUntil), this->id, r.reassemblyLine);
+    r.fragmentsDiscarded++;
+    r.reassembly.clear();
+    r.reassemblyLine = -1;
+}
+
+void Protocol::uploadPayload(const std::string &payload, seqnum sequenceNumber) {
+    this->receiverInfo.framesDelivered++;
+    this->receiverInfo.bytesDelivered += payload.size();
+    if (this->sink) this->sink->deliver(payload.data(), payload.size());
+    this->log("Uploading payload = \"%s\" At time [%.3f] and seq_num = [%u] to the network layer", payload, this->getRealTime(this->receiverInfo.processedUntil), sequenceNumber);
+}
+
+void Protocol::handleFrame(Frame* frame, bool self)
+{
+#ifdef GBN_PROFILE
+    Profiler::current = &this->profiler;
+#endif
+
+    if (frame->frameType == CONTROL_FRAME) {
+        this->control(ConvertBitsToString(frame->payload));
+        delete frame;
+        return;
+    }
+
+    // Call the appropriate function
+    if (this->isSender) this->sender(frame, self);
+    else this->receiver(frame);
+}
+
+void Protocol::save(CheckpointWriter &out) const {
+    out.write<uint8_t>(this->isSender);
+
+    // The parameters phase actions may have changed.
+    out.write<int32_t>(this->config.windowSize);
+    for (double LinkConfig::* p : RUNTIME_PARAMETERS) out.write<double>(this->config.*p);
+
+    out.write<float>(this->senderInfo.startingTime);
+    out.write<uint32_t>(this->senderInfo.wStart);
+    out.write<uint32_t>(this->senderInfo.wCurrent);
+    out.write<int32_t>(this->senderInfo.currentLineOffset);
+    out.write<int32_t>(this->senderInfo.currentFragment);
+    out.write<int32_t>(this->senderInfo.currentUnitOffset);
+    out.write<uint32_t>(this->senderInfo.window.size());
+    for (const DataUnit &unit : this->senderInfo.window) {
+        out.write<int32_t>(unit.index);
+        out.write<int32_t>(unit.line);
+        out.write<int32_t>(unit.lines);
+        out.write<int32_t>(unit.fragment);
+        out.write<uint8_t>(unit.last);
+    }
+    out.write<int32_t>(this->senderInfo.nextNewUnit);
+    out.write<uint8_t>(this->senderInfo.started);
+    out.write<uint8_t>(this->senderInfo.paused);
+    out.write<int64_t>(this->senderInfo.dataFramesSent);
+    out.write<int64_t>(this->senderInfo.retransmissions);
+    out.write<int64_t>(this->senderInfo.bytesRetransmitted);
+    out.write<int64_t>(this->senderInfo.staleAcksDiscarded);
+
+    uint32_t timers = 0;
+    for (Timer* t = this->senderInfo.timers; t; t = t->next) timers++;
+    out.write<uint32_t>(timers);
+    for (Timer* t = this->senderInfo.timers; t; t = t->next) out.writeFrameRef(t->msg);
+    out.write<double>(this->senderInfo.processedUntil);
+
+    out.write<uint32_t>(this->receiverInfo.expectedFrameSequence);
+    out.writeString(this->receiverInfo.reassembly);
+    out.write<int32_t>(this->receiverInfo.reassemblyLine);
+    out.write<int32_t>(this->receiverInfo.reassemblyNext);
+    out.write<int64_t>(this->receiverInfo.fragmentsDiscarded);
+    out.write<int64_t>(this->receiverInfo.framesDelivered);
+    out.write<int64_t>(this->receiverInfo.bytesDelivered);
+    out.write<int64_t>(this->receiverInfo.acksSent);
+    out.write<int64_t>(this->receiverInfo.nacksSent);
+    out.write<int64_t>(this->receiverInfo.framesCorrected);
+    out.write<int64_t>(this->receiverInfo.bitsCorrected);
+    out.write<int64_t>(this->receiverInfo.framesUncorrectable);
+    out.write<uint8_t>(this->receiverInfo.gapOpen);
+    out.write<uint32_t>(this->receiverInfo.gapDistance);
+    out.write<double>(this->receiverInfo.gapAckedAt);
+    out.write<int64_t>(this->receiverInfo.gapEpisodes);
+    out.write<int64_t>(this->receiverInfo.gapAcksSent);
+    out.write<int64_t>(this->receiverInfo.gapAcksSuppressed);
+    out.write<double>(this->receiverInfo.processedUntil);
+
+    out.write<double>(this->linkInfo.busyUntil);
+    out.write<uint32_t>(this->linkInfo.queue.size());
+    for (double t : this->linkInfo.queue) out.write<double>(t);
+    out.write<int64_t>(this->linkInfo.framesSent);
+    out.write<int64_t>(this->linkInfo.framesDropped);
+    out.write<int64_t>(this->linkInfo.bitsSent);
+    out.write<int64_t>(this->linkInfo.queueOccupancy.count);
+    out.write<double>(this->linkInfo.queueOccupancy.sum);
+    out.write<double>(this->linkInfo.queueOccupancy.min);
+    out.write<double>(this->linkInfo.queueOccupancy.max);
+
+    this->errorModel.save(out);
+    this->codec.save(out);
+
+    out.write<uint8_t>((bool)this->sink);
+    if (this->sink) {
+        out.write<uint64_t>(this->sink->getHash());
+        out.write<int64_t>(this->sink->getRecords());
+        out.write<int64_t>(this->sink->getBytes());
+    }
+
+    std::vector<int> buffered;
+    if (this->isSender) buffered = this->input->BufferedLines();
+    out.write<uint32_t>(buffered.size());
+    for (int n : buffered) out.write<int32_t>(n);
+}
+
+void Protocol::load(CheckpointReader &in) {
+    this->isSender = in.read<uint8_t>();
+
+    this->config.windowSize = in.read<int32_t>();
+    for (double LinkConfig::* p : RUNTIME_PARAMETERS) this->config.*p = in.read<double>();
+    if (this->config.windowSize < 1 || this->config.windowSize >= this->config.sequenceSpace)
+        throw std::runtime_error("Bad window size in checkpoint.");
+
+    this->senderInfo.startingTime = in.read<float>();
+    this->senderInfo.wStart = in.read<uint32_t>();
+    this->senderInfo.wCurrent = in.read<uint32_t>();
+    this->senderInfo.currentLineOffset = in.read<int32_t>();
+    this->senderInfo.currentFragment = in.read<int32_t>();
+    this->senderInfo.currentUnitOffset = in.read<int32_t>();
+    this->senderInfo.window.resize(in.read<uint32_t>());
+    for (DataUnit &unit : this->senderInfo.window) {
+        unit.index = in.read<int32_t>();
+        unit.line = in.read<int32_t>();
+        unit.lines = in.read<int32_t>();
+        unit.fragment = in.read<int32_t>();
+        unit.last = in.read<uint8_t>() != 0;
+    }
+    this->senderInfo.nextNewUnit = in.read<int32_t>();
+    this->senderInfo.started = in.read<uint8_t>() != 0;
+    this->senderInfo.paused = in.read<uint8_t>() != 0;
+    this->senderInfo.dataFramesSent = (long)in.read<int64_t>();
+    this->senderInfo.retransmissions = (long)in.read<int64_t>();
+    this->senderInfo.bytesRetransmitted = (long)in.read<int64_t>();
+    this->senderInfo.staleAcksDiscarded = (long)in.read<int64_t>();
+
+    for (uint32_t count = in.read<uint32_t>(); count; count--) {
+        Timer* timer = new Timer();
+        timer->msg = in.readFrameRef();
+        timer->prev = this->senderInfo.timersEnd;
+        if (timer->prev) timer->prev->next = timer;
+        else this->senderInfo.timers = timer;
+        this->senderInfo.timersEnd = timer;
+    }
+    this->senderInfo.processedUntil = in.read<double>();
+
+    this->receiverInfo.expectedFrameSequence = in.read<uint32_t>();
+    this->receiverInfo.reassembly = in.readString();
+    this->receiverInfo.reassemblyLine = in.read<int32_t>();
+    this->receiverInfo.reassemblyNext = in.read<int32_t>();
+    this->receiverInfo.fragmentsDiscarded = (long)in.read<int64_t>();
+    this->receiverInfo.framesDelivered = (long)in.read<int64_t>();
+    this->receiverInfo.bytesDelivered = (long)in.read<int64_t>();
+    this->receiverInfo.acksSent = (long)in.read<int64_t>();
+    this->receiverInfo.nacksSent = (long)in.read<int64_t>();
+    this->receiverInfo.framesCorrected = (long)in.read<int64_t>();
+    this->receiverInfo.bitsCorrected = (long)in.read<int64_t>();
+    this->receiverInfo.framesUncorrectable = (long)in.read<int64_t>();
+    this->receiverInfo.gapOpen = in.read<uint8_t>() != 0;
+    this->receiverInfo.gapDistance = in.read<uint32_t>();
+    this->receiverInfo.gapAckedAt = in.read<double>();
+    this->receiverInfo.gapEpisodes = (long)in.read<int64_t>();
+    this->receiverInfo.gapAcksSent = (long)in.read<int64_t>();
+    this->receiverInfo.gapAcksSuppressed = (long)in.read<int64_t>();
+    this->receiverInfo.processedUntil = in.read<double>();
+
+    this->linkInfo.busyUntil = in.read<double>();
+    for (uint32_t count = in.read<uint32_t>(); count; count--) this->linkInfo.queue.push_back(in.read<double>());
+    this->linkInfo.framesSent = (long)in.read<int64_t>();
+    this->linkInfo.framesDropped = (long)in.read<int64_t>();
+    this->linkInfo.bitsSent = (long)in.read<int64_t>();
+    this->linkInfo.queueOccupancy.count = (long)in.read<int64_t>();
+    this->linkInfo.queueOccupancy.sum = in.read<double>();
+    this->linkInfo.queueOccupancy.min = in.read<double>();
+    this->linkInfo.queueOccupancy.max = in.read<double>();
+
+    this->errorModel.configure(this->config, this->scheduler);
+    this->errorModel.load(in);
+    this->codec.load(in);
+
+    if (in.read<uint8_t>()) {
+        uint64_t hash = in.read<uint64_t>();
+        long records = (long)in.read<int64_t>();
+        long bytes = (long)in.read<int64_t>();
+        if (this->config.deliveryOutput.empty())
+            throw std::runtime_error("The checkpoint was written with a delivery sink, but DO is not set.");
+        this->sink.reset(DeliverySink::create(this->config.deliveryOutput, true));
+        this->sink->resume(hash, records, bytes);
+    }
+
+    std::vector<int> buffered(in.read<uint32_t>());
+    for (int &n : buffered) n = in.read<int32_t>();
+    if (this->isSender) {
+        this->input->OpenFile();
+        this->input->SetBufferSize(this->config.windowSize);
+        this->input->RestoreBufferedLines(buffered);
+        this->input->StartPrefetch(this->config.readAhead);
+    }
+}
+
+ProtocolTelemetry Protocol::telemetry() const
+{
+    ProtocolTelemetry t;
+    t.framesInFlight = (long)this->senderInfo.window.size();
+    for (Timer* timer = this->senderInfo.timers; timer; timer = timer->next) t.timers++;
+    double now = this->scheduler->getTime();
+    t.senderBacklog = std::max(this->senderInfo.processedUntil - now, 0.0);
+    t.receiverBacklog = std::max(this->receiverInfo.processedUntil - now, 0.0);
+    t.transmitQueue = (long)this->linkInfo.queue.size();
+    if (this->isSender) t.bufferedLines = this->input->BufferedLineCount();
+    return t;
+}
+
+void Protocol::finish()
+{
+    this->scheduler->recordResult("dataFramesSent", this->senderInfo.dataFramesSent);
+    this->scheduler->recordResult("retransmissions", this->senderInfo.retransmissions);
+    this->scheduler->recordResult("framesDelivered", this->receiverInfo.framesDelivered);
+    this->scheduler->recordResult("bytesDelivered", this->receiverInfo.bytesDelivered);
+    this->scheduler->recordResult("acksSent", this->receiverInfo.acksSent);
+    this->scheduler->recordResult("nacksSent", this->receiverInfo.nacksSent);
+    this->scheduler->recordResult("bytesRetransmitted", this->senderInfo.bytesRetransmitted);
+    this->scheduler->recordResult("staleAcksDiscarded", this->senderInfo.staleAcksDiscarded);
+
+    // The acks of out-of-order frames per gap are the ack events each loss costs the sender.
+    if (this->receiverInfo.gapEpisodes) {
+        this->scheduler->recordResult("gapEpisodes", this->receiverInfo.gapEpisodes);
+        this->scheduler->recordResult("gapAcksSent", this->receiverInfo.gapAcksSent);
+        this->scheduler->recordResult("gapAcksSuppressed", this->receiverInfo.gapAcksSuppressed);
+        this->scheduler->recordResult("gapAcksPerEpisode", (double)this->receiverInfo.gapAcksSent / this->receiverInfo.gapEpisodes);
+    }
+
+    if (this->config.mtu) this->scheduler->recordResult("fragmentsDiscarded", this->receiverInfo.fragmentsDiscarded);
+
+    if (this->config.fec) {
+        this->scheduler->recordResult("fecFramesCorrected", this->receiverInfo.framesCorrected);
+        this->scheduler->recordResult("fecBitsCorrected", this->receiverInfo.bitsCorrected);
+        this->scheduler->recordResult("fecFramesUncorrectable", this->receiverInfo.framesUncorrectable);
+    }
+
+    if (this->sink) {
+        this->sink->flush();
+        if (this->scheduler->getTime() > 0) this->scheduler->recordResult("deliveryThroughput", this->sink->getBytes() / this->scheduler->getTime());
+        if (this->deliveryReference)
+            this->scheduler->recordResult("deliveryIntact", this->sink->getHash() == ExpectedDeliveryHash(*this->deliveryReference));
+    }
+
+    if (this->isSender && this->config.readAhead) {
+        this->scheduler->recordResult("readAheadHits", this->input->PrefetchHits());
+        this->scheduler->recordResult("readAheadMisses", this->input->PrefetchMisses());
+    }
+
+    if (this->config.datarate > 0) {
+        this->scheduler->recordResult("framesTransmitted", this->linkInfo.framesSent);
+        this->scheduler->recordResult("framesDroppedAtQueue", this->linkInfo.framesDropped);
+        this->scheduler->recordResult("bitsTransmitted", this->linkInfo.bitsSent);
+        if (this->scheduler->getTime() > 0) this->scheduler->recordResult("linkUtilization", this->linkInfo.bitsSent / this->config.datarate / this->scheduler->getTime());
+        this->scheduler->recordResult("transmitQueueOccupancy:mean", this->linkInfo.queueOccupancy.mean());
+        this->scheduler->recordResult("transmitQueueOccupancy:max", this->linkInfo.queueOccupancy.max);
+    }
+
+    if (this->errorModel.isActive()) {
+        this->scheduler->recordResult("channelFramesLost", this->errorModel.framesLost);
+        this->scheduler->recordResult("channelFramesCorrupted", this->errorModel.framesCorrupted);
+        this->scheduler->recordResult("channelBitsFlipped", this->errorModel.bitsFlipped);
+        this->scheduler->recordResult("channelFramesDuplicated", this->errorModel.framesDuplicated);
+        this->scheduler->recordResult("channelFramesReordered", this->errorModel.framesReordered);
+    }
+
+    if (this->codec.framesCompressed) {
+        this->scheduler->recordResult("compressionRatio", (double)this->codec.bytesAfterCompression / std::max(1L, this->codec.bytesBeforeCompression));
+        this->scheduler->recordResult("compressionTimePerFrame", this->codec.compressionTime / this->codec.framesCompressed);
+    }
+    if (this->codec.framesDecompressed) {
+        this->scheduler->recordResult("decompressionTimePerFrame", this->codec.decompressionTime / this->codec.framesDecompressed);
+        this->scheduler->recordResult("decompressionErrors", this->codec.decompressionErrors);
+    }
+
+#ifdef GBN_PROFILE
+    for (int i = 0; i < PROF_SECTION_COUNT; i++) {
+        if (!this->profiler.counters[i].calls) continue;
+        this->scheduler->recordResult((std::string("profile:") + Profiler::sectionName(i) + ":calls").c_str(), this->profiler.counters[i].calls);
+        this->scheduler->recordResult((std::string("profile:") + Profiler::sectionName(i) + ":ticks").c_str(), this->profiler.counters[i].ticks);
+    }
+#endif
+}
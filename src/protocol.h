@@ -0,0 +1,409 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include <deque>
+#include <memory>
+#include "util.h"
+#include "frame.h"
+#include "scheduler.h"
+#include "errormodel.h"
+#include "profiler.h"
+#include "checkpoint.h"
+#include "sink.h"
+#include "compression.h"
+#include "fec.h"
+#include "checksum.h"
+#include "logformat.h"
+
+// Doubly-linked list node for the timers.
+struct Timer {
+    Frame* msg = NULL;
+    Timer* next = NULL;
+    Timer* prev = NULL;
+};
+
+// The data sent in one frame: a whole line, with aggregation several consecutive lines,
+// or with an MTU one fragment of those.
+struct DataUnit {
+
+    // The number of units before this one in the input.
+    int index = 0;
+
+    // The first line and the number of lines.
+    int line = 0;
+    int lines = 1;
+
+    int fragment = 0;
+
+    // Whether this is the last (or only) fragment of its lines.
+    bool last = true;
+};
+
+// Data frames read and framed in one pass before being sent. The vectors are
+// only ever grown, so their strings and payloads are reused across batches.
+// The lines are those the units of the batch are cut from.
+struct FrameBatch {
+    std::vector<std::string> lines;
+    std::vector<bool> readFromBuffer;
+
+    std::vector<DataUnit> units;
+    std::vector<int> unitLines;
+
+    // Whether a line of the unit was read from disk for it, which takes the processing time.
+    std::vector<bool> fromDisk;
+
+    // The error code the unit is sent with.
+    std::vector<std::string> errorCodes;
+
+    // The sub-records of the unit being aggregated, and the unit compressed.
+    std::string packet;
+    std::string compressed;
+
+    std::vector<vecBitset8> payloads;
+    std::vector<bitset8> parities;
+    int size = 0;
+};
+
+struct SenderInfo {
+
+    // Sequence number of the start of the window.
+    seqnum wStart = 0;
+
+    // The next sequence number to be sent.
+    seqnum wCurrent = 0;
+
+    // The line number in the text file corresponding to the
+    // current wStart.
+    int currentLineOffset = 0;
+
+    // With an MTU, the fragment of that line at wStart; and the number of units
+    // (lines, or fragments) before wStart.
+    int currentFragment = 0;
+    int currentUnitOffset = 0;
+
+    // The units sent from wStart up to wCurrent.
+    std::deque<DataUnit> window;
+
+    // The starting time the sender should start sending frames.
+    // Received from the coordinator.
+    float startingTime = 0.0;
+
+    // This is a vector of self-messages, acting as timeouts.
+    Timer* timers = NULL;
+
+    // The last timer in the list, so that creating a timer does not walk the window.
+    Timer* timersEnd = NULL;
+
+    // The unit after the furthest one sent so far; units before it are retransmitted.
+    int nextNewUnit = 0;
+
+    // Whether the first frames have been sent, and whether a phase action has stopped
+    // sending new units; units already sent are still retransmitted while stopped.
+    bool started = false;
+    bool paused = false;
+
+    long dataFramesSent = 0;
+    long retransmissions = 0;
+    long bytesRetransmitted = 0;
+
+    // Acks and nacks discarded without advancing the window: stale ones from before the
+    // window last moved, and with GA = 1 duplicates that acknowledge nothing new.
+    long staleAcksDiscarded = 0;
+
+    // When the frames queued for processing so far are processed; each frame departs then.
+    double processedUntil = 0;
+
+    FrameBatch batch;
+};
+
+// State of the transmitter of a node under the link model.
+struct LinkInfo {
+
+    // The time at which the last queued frame finishes serialization.
+    double busyUntil = 0;
+
+    // Serialization finishing times of the frames still in the transmit queue.
+    std::deque<double> queue;
+
+    long framesSent = 0;
+    long framesDropped = 0;
+    long bitsSent = 0;
+
+    // Transmit queue occupancy seen by each arriving frame.
+    RunningStat queueOccupancy;
+};
+
+struct ReceiverInfo {
+
+    // The next expected frame sequence.
+    seqnum expectedFrameSequence = 0;
+
+    // The fragments of the line being received, until its last fragment arrives, the line
+    // they are cut from (-1 if none) and the index of the fragment that continues them.
+    std::string reassembly;
+    int reassemblyLine = -1;
+    int reassemblyNext = 0;
+
+    // Fragments that did not continue the line being reassembled, and partial lines
+    // abandoned for them, neither of which is uploaded.
+    long fragmentsDiscarded = 0;
+
+    // Lines and payload bytes uploaded to the network layer, and acks and nacks sent.
+    long framesDelivered = 0;
+    long bytesDelivered = 0;
+    long acksSent = 0;
+    long nacksSent = 0;
+
+    // With FEC, the frames with bits corrected, the bits corrected, and the frames with
+    // errors detected that could not be corrected.
+    long framesCorrected = 0;
+    long bitsCorrected = 0;
+    long framesUncorrectable = 0;
+
+    // Whether out-of-order frames are arriving since a loss, how far past the expected
+    // sequence number the last one was, and when the gap was last acked.
+    bool gapOpen = false;
+    seqnum gapDistance = 0;
+    double gapAckedAt = 0;
+
+    // The gaps after losses, and the acks of out-of-order frames sent and, with GA = 1, not sent.
+    long gapEpisodes = 0;
+    long gapAcksSent = 0;
+    long gapAcksSuppressed = 0;
+
+    // When the acks queued for processing so far are processed; each ack departs then.
+    double processedUntil = 0;
+};
+
+// The size of the live state of a node at some point of the run, for telemetry.
+struct ProtocolTelemetry {
+    long framesInFlight = 0;
+    long timers = 0;
+    // The processing time queued at the sender and the receiver, in seconds.
+    double senderBacklog = 0;
+    double receiverBacklog = 0;
+    long transmitQueue = 0;
+    long bufferedLines = 0;
+};
+
+// The Go-Back-N sender and receiver state machines of one node. The protocol is driven
+// through handleFrame() and reaches the simulation kernel only through its Scheduler,
+// so it runs unchanged under OMNeT++ (Node) and under the headless engine.
+class Protocol
+{
+  public:
+    // The parameters are copied. The input text file is owned by the caller, and only
+    // opened if the node becomes the sender.
+    Protocol(int id, const LinkConfig &config, Scheduler* scheduler, TextFile* input);
+    virtual ~Protocol();
+
+    // Handles the initial info from the coordinator: the starting node and its starting time.
+    virtual void start(int startingNodeID, double startingTime);
+
+    // Handles a frame, either scheduled by this node or received from the peer.
+    // Takes ownership of the frame.
+    virtual void handleFrame(Frame* frame, bool self);
+
+    // Records the end-of-run statistics through the scheduler.
+    virtual void finish();
+
+    // Writes the sender or receiver state into a checkpoint: the window, timers, processing
+    // queues, link and channel state, and the buffered input lines. Pending frames are
+    // referred to by their index, so the scheduler writes them first.
+    virtual void save(CheckpointWriter &out) const;
+
+    // Restores the state written by save() in place of start(), once the scheduler has
+    // read the pending frames back.
+    virtual void load(CheckpointReader &in);
+
+    // Counts the frames in flight, timers, processing backlog, queued frames and buffered
+    // input lines. Walks the lists, so it is meant to be sampled now and then.
+    ProtocolTelemetry telemetry() const;
+
+    // The sender's input, owned by the caller, which the delivered data is checked
+    // against at the end of the run when the node delivers it to a sink.
+    void setDeliveryReference(TextFile* reference) { deliveryReference = reference; }
+    const DeliverySink* getDeliverySink() const { return sink.get(); }
+
+    int getId() const { return id; }
+    bool isSenderNode() const { return isSender; }
+    const LinkConfig& getConfig() const { return config; }
+
+#ifdef GBN_PROFILE
+    Profiler profiler;
+#endif
+
+  protected:
+    // The sequence arithmetic and checksum of the generic protocol, for the paths that
+    // take them as a Core: the modulus, seqDistance, checksum and verifyChecksum below.
+    // ProtocolCore passes its own, fixed at compile time.
+    struct GenericCore {
+        Protocol* protocol;
+        seqnum modulus(int64_t a) const { return protocol->Protocol::modulus(a); }
+        seqnum seqDistance(seqnum from, seqnum to) const { return protocol->Protocol::modulus(int64_t(to) - int64_t(from)); }
+        bitset8 checksum(vecBitset8 const &bytes) const { return protocol->Protocol::checksum(bytes); }
+        bool verifyChecksum(vecBitset8 const &bytes, bitset8 const &parity) const { return protocol->Protocol::verifyChecksum(bytes, parity); }
+    };
+
+    // Main function of the sender node.
+    virtual void sender(Frame *msg, bool self);
+
+    // Main function of the receiver node.
+    virtual void receiver(Frame *msg);
+
+    // The sender and the receiver over the given Core. These and the other templates below
+    // are the paths taken for every frame, defined in protocolpaths.h, so that the calls of
+    // ProtocolCore into its Core are bound statically and inlined.
+    template<class Core> void sender(const Core &core, Frame *msg, bool self);
+    template<class Core> void receiver(const Core &core, Frame *msg);
+
+    // Checks if the sender should terminate operation: when there is no more outstanding
+    // frames. Called in sendDataFrame() below when there is no more lines to read from the file.
+    // Returns whether the run was ended.
+    virtual bool checkTermination();
+
+    // The unit `d` places after wStart, for d up to the number of units in flight.
+    virtual DataUnit unitAt(int d);
+
+    // The number of the `count` frames from unit `first` on that may be sent: all of them,
+    // unless new units are stopped, when only the units sent before.
+    int sendableFrames(const DataUnit &first, int count) const;
+
+    // Sends up to `framesToSend` frames after wCurrent and advances it over them, checking
+    // for termination if the input ends.
+    virtual void sendNewFrames(int framesToSend, int errorFreeIndex);
+    template<class Core> void sendNewFrames(const Core &core, int framesToSend, int errorFreeIndex);
+
+    // Carries out a phase action of the coordinator: "stop", "start" or "<parameter> <value>".
+    // Throws std::runtime_error on a value the run cannot take.
+    virtual void control(const std::string &command);
+
+    // Reads, frames and checksums up to `count` data frames starting from the given unit
+    // into the frame batch, cutting lines longer than the MTU into fragments. Returns the
+    // number of frames prepared, fewer than `count` when there are no more lines to read.
+    template<class Core> int prepareDataFrames(const Core &core, const DataUnit &first, int count);
+
+    // Sends the ith frame of the batch with the given sequence number, whether it should be
+    // errorFree, calculates the time it is handed to the link and returns it in realTime.
+    virtual void sendDataFrame(int i, seqnum dataSequenceNumber, bool errorFree, float &realTime, bool timeout);
+
+    // Prepares up to `count` data frames starting from the given unit and sequence number,
+    // then sends them and starts their timers in one pass. The frame at errorFreeIndex
+    // (-1 for none) is sent error-free. The units sent are left in the batch.
+    // Returns the number of frames sent, fewer than `count` when there are no more lines.
+    template<class Core> int sendDataFrames(const Core &core, const DataUnit &first, seqnum dataSequenceNumber, int count, int errorFreeIndex, bool timeout);
+
+    // Puts a frame on the link towards the peer at its departure time, no earlier than now,
+    // after the given extra delay. It is sent right away, arriving after the time until its
+    // departure as well. With a datarate set, the frame is queued behind the frames still
+    // being serialized when it departs, or dropped if the transmit queue is full then.
+    // Since the frame enters the event set now rather than at its departure, it is handled
+    // before the events due at the same time that are scheduled in between; the random
+    // numbers of the run are drawn in that order too.
+    virtual void transmit(Frame* msg, double departure, double extraDelay);
+
+    // Returns the length of the frame on the wire in bits.
+    virtual long frameBits(Frame* msg);
+
+    // Sends an ACK/NACK, applying the ack loss probability if LP = true
+    //
+    virtual void sendAck(int ACK_TYPE, bool LP = true);
+
+    // Acknowledges an out-of-order frame with the given sequence number with the next expected
+    // one, unless GA = 1 and the frame comes after the one before it in a gap acknowledged already.
+    template<class Core> void sendGapAck(const Core &core, seqnum sequenceNumber);
+
+    // Drops the partial line being reassembled, if there is one.
+    virtual void discardReassembly();
+
+    // Uploads one line received in the frame with the given sequence number to the network layer.
+    virtual void uploadPayload(const std::string &payload, seqnum sequenceNumber);
+
+    // Performs mod operation over the sequence space that is valid for
+    // negative numbers as well as positive numbers.
+    virtual seqnum modulus(int64_t a);
+
+    // Serial-number arithmetic: the number of steps going forward from
+    // sequence number `from` to sequence number `to`.
+    virtual seqnum seqDistance(seqnum from, seqnum to);
+
+    // The checksum of a framed payload, and whether it matches, under the CS parameter.
+    virtual bitset8 checksum(vecBitset8 const &bytes);
+    virtual bool verifyChecksum(vecBitset8 const &bytes, bitset8 const &parity);
+
+    // Modifies a random bit in the payload in place, and returns the
+    // position of modified bit, or -1 for an empty payload.
+    virtual int modifyPayload(vecBitset8 &payload);
+
+    // Creates a timer with the given ackSequence number, inserts it into
+    // the doubly-linked list of timers and returns it.
+    virtual Timer* createTimer(seqnum ackSequence);
+
+    // Deletes a timer with the given ackSequence number, and removes it from
+    // the doubly-linked list, and all timers after or before it.
+    // Returns the head of the linked list after deletion of timers.
+    template<class Core> Timer* deleteTimers(const Core &core, seqnum ackSequence, bool prev);
+
+    // On receiving an ack/nack sequence at the sender, calculates and advances
+    // the window and sends new frames.
+    template<class Core> void advanceWindowAndSendFrames(const Core &core, seqnum ackSequence, bool prev);
+
+    // Logs the given printf-style string and format to the scheduler's log.
+    // Nothing is formatted, and no views are read, while the scheduler's log is disabled.
+    template<typename... Args> void log(const char * f, const Args&... args);
+
+    // The time a frame queued now for processing on the processor busy until `processedUntil`
+    // starts being processed: now, or once the frames queued before it are processed.
+    virtual double getRealTime(double processedUntil);
+
+    // Queues a frame taking `processingTime` for processing and returns when it departs.
+    virtual double queueForProcessing(double &processedUntil, double processingTime);
+
+    // The id of the node.
+    int id;
+
+    // The parameters of the link, validated.
+    LinkConfig config;
+
+    Scheduler* scheduler;
+
+    // The input text file of the node.
+    TextFile *input;
+
+    // Whether the node is the sender.
+    bool isSender = false;
+
+    struct SenderInfo senderInfo;
+    struct ReceiverInfo receiverInfo;
+    struct LinkInfo linkInfo;
+
+    // Stochastic errors of the frames this node transmits.
+    ChannelErrorModel errorModel;
+
+    // Compresses the payloads this node sends and decompresses those it receives.
+    PayloadCodec codec;
+
+    // The buffer the log lines are formatted into.
+    LogFormatter logFormatter;
+
+    // The receiver's network layer, if the link delivers to one, and the input to check it against.
+    std::unique_ptr<DeliverySink> sink;
+    TextFile *deliveryReference = NULL;
+};
+
+#endif /* PROTOCOL_H_ */
@@ -0,0 +1,48 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include "protocolcore.h"
+#include "protocolpaths.h"
+
+template<class Checksum>
+static Protocol* CreateWithChecksum(int id, const LinkConfig &config, Scheduler* scheduler, TextFile* input) {
+    switch (config.sequenceSpace) {
+    case int64_t(1) << 1: return new ProtocolCore<MaskedSequence<1>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 2: return new ProtocolCore<MaskedSequence<2>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 3: return new ProtocolCore<MaskedSequence<3>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 4: return new ProtocolCore<MaskedSequence<4>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 5: return new ProtocolCore<MaskedSequence<5>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 6: return new ProtocolCore<MaskedSequence<6>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 7: return new ProtocolCore<MaskedSequence<7>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 8: return new ProtocolCore<MaskedSequence<8>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 9: return new ProtocolCore<MaskedSequence<9>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 10: return new ProtocolCore<MaskedSequence<10>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 11: return new ProtocolCore<MaskedSequence<11>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 12: return new ProtocolCore<MaskedSequence<12>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 13: return new ProtocolCore<MaskedSequence<13>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 14: return new ProtocolCore<MaskedSequence<14>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 15: return new ProtocolCore<MaskedSequence<15>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 16: return new ProtocolCore<MaskedSequence<16>, Checksum>(id, config, scheduler, input);
+    case int64_t(1) << 32: return new ProtocolCore<MaskedSequence<32>, Checksum>(id, config, scheduler, input);
+    default: return new Protocol(id, config, scheduler, input);
+    }
+}
+
+Protocol* CreateProtocol(int id, const LinkConfig &config, Scheduler* scheduler, TextFile* input) {
+    switch (config.checksum) {
+    case CHECKSUM_CRC8: return CreateWithChecksum<Crc8Checksum>(id, config, scheduler, input);
+    default: return CreateWithChecksum<OnesComplementChecksum>(id, config, scheduler, input);
+    }
+}
@@ -0,0 +1,83 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef PROTOCOLCORE_H_
+#define PROTOCOLCORE_H_
+
+#include "protocol.h"
+#include "checksum.h"
+
+// Sequence number arithmetic over a space of 2^Bits numbers, with a mask in place of
+// the two divisions of the generic modulus. Negative numbers are masked correctly in
+// two's complement.
+template<int Bits> struct MaskedSequence {
+    static const int64_t space = int64_t(1) << Bits;
+    static seqnum modulus(int64_t a) { return seqnum(a & (space - 1)); }
+};
+
+// The protocol with its sequence arithmetic and checksum fixed at compile time, for the
+// configurations CreateProtocol() instantiates. The sender and the receiver run over its
+// Core, so they call it without a virtual call; everything else is the generic Protocol.
+template<class Sequence, class Checksum> class ProtocolCore : public Protocol {
+  public:
+    ProtocolCore(int id, const LinkConfig &config, Scheduler* scheduler, TextFile* input)
+        : Protocol(id, config, scheduler, input) {}
+
+  protected:
+    struct Core {
+        seqnum modulus(int64_t a) const { return Sequence::modulus(a); }
+        seqnum seqDistance(seqnum from, seqnum to) const { return Sequence::modulus(int64_t(to) - int64_t(from)); }
+        bitset8 checksum(vecBitset8 const &bytes) const { return Checksum::compute(bytes); }
+        bool verifyChecksum(vecBitset8 const &bytes, bitset8 const &parity) const {
+            PROFILE_SCOPE(PROF_VERIFY_CHECKSUM);
+            return Checksum::compute(bytes) == parity;
+        }
+    };
+
+    using Protocol::sender;
+    using Protocol::receiver;
+    using Protocol::sendNewFrames;
+
+    virtual void sender(Frame *msg, bool self) override final {
+        this->sender(Core(), msg, self);
+    }
+    virtual void receiver(Frame *msg) override final {
+        this->receiver(Core(), msg);
+    }
+    virtual void sendNewFrames(int framesToSend, int errorFreeIndex) override final {
+        this->sendNewFrames(Core(), framesToSend, errorFreeIndex);
+    }
+
+    // The same for the paths that are not taken per frame.
+    virtual seqnum modulus(int64_t a) override final {
+        return Core().modulus(a);
+    }
+    virtual seqnum seqDistance(seqnum from, seqnum to) override final {
+        return Core().seqDistance(from, to);
+    }
+    virtual bitset8 checksum(vecBitset8 const &bytes) override final {
+        return Core().checksum(bytes);
+    }
+    virtual bool verifyChecksum(vecBitset8 const &bytes, bitset8 const &parity) override final {
+        return Core().verifyChecksum(bytes, parity);
+    }
+};
+
+// Creates the protocol of a node: a ProtocolCore when the sequence space is a power of two
+// up to 2^16 or 2^32 (such as WS = 3, 7, 15... with SN = 0, or SN set), for either checksum,
+// and the generic Protocol otherwise. The configuration must be validated.
+Protocol* CreateProtocol(int id, const LinkConfig &config, Scheduler* scheduler, TextFile* input);
+
+#endif /* PROTOCOLCORE_H_ */
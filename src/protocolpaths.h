@@ -0,0 +1,446 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef PROTOCOLPATHS_H_
+#define PROTOCOLPATHS_H_
+
+// The paths of the sender and the receiver taken for every frame, over the sequence
+// arithmetic and checksum of a Core (see Protocol::GenericCore). Included where they are
+// instantiated: protocol.cc for the generic protocol, protocolcore.cc for ProtocolCore.
+
+#include <algorithm>
+#include <bitset>
+#include "protocol.h"
+
+template<typename... Args> void Protocol::log(const char * f, const Args&... args) {
+    if (!this->scheduler->isLogEnabled()) return;
+    PROFILE_SCOPE(PROF_LOG);
+
+    const std::string &line = this->logFormatter.format(f, args...);
+    this->scheduler->writeLog(line.data(), line.size());
+}
+
+template<class Core> int Protocol::prepareDataFrames(const Core &core, const DataUnit &first, int count) {
+    PROFILE_SCOPE(PROF_PREPARE_FRAMES);
+
+    // Every unit takes at least one line, so `count` lines are read up front; aggregated
+    // units read the further lines they take as they go.
+    FrameBatch &batch = this->senderInfo.batch;
+    int lines = this->input->ReadLines(first.line, count, batch.lines, batch.readFromBuffer);
+
+    if ((int)batch.payloads.size() < count) {
+        batch.units.resize(count);
+        batch.unitLines.resize(count);
+        batch.fromDisk.resize(count);
+        batch.errorCodes.resize(count);
+        batch.payloads.resize(count);
+        batch.parities.resize(count);
+    }
+
+    // Framing and checksumming the payloads, excluding the error code prefix of the lines.
+    size_t mtu = this->config.mtu;
+    size_t aggregation = this->config.aggregationLimit;
+    batch.size = 0;
+    for (int i = 0; i < lines && batch.size < count; ) {
+        const std::string &line = batch.lines[i];
+        size_t prefix = std::min<size_t>(5, line.size());
+        const char* data = line.data() + prefix;
+        size_t length = line.size() - prefix;
+        int unitLines = 1;
+        bool fromDisk = !batch.readFromBuffer[i];
+        std::bitset<4> errorCode;
+
+        // Packing the following lines into the unit as long as they fit in the limit,
+        // under the error codes of all of them.
+        if (aggregation) {
+            std::string &packet = batch.packet;
+            packet.clear();
+            AppendSubRecord(packet, data, length);
+            errorCode = std::bitset<4>(line.substr(0, 4));
+
+            while (true) {
+                if (i + unitLines == lines)
+                    lines += this->input->ReadLines(first.line + lines, 1, batch.lines, batch.readFromBuffer, lines);
+                if (i + unitLines == lines) break;
+
+                const std::string &next = batch.lines[i + unitLines];
+                size_t nextPrefix = std::min<size_t>(5, next.size());
+                if (packet.size() + SubRecordSize(next.size() - nextPrefix) > aggregation) break;
+
+                AppendSubRecord(packet, next.data() + nextPrefix, next.size() - nextPrefix);
+                errorCode |= std::bitset<4>(next.substr(0, 4));
+                fromDisk = fromDisk || !batch.readFromBuffer[i + unitLines];
+                unitLines++;
+            }
+
+            data = packet.data();
+            length = packet.size();
+        }
+
+        if (this->config.compression) {
+            this->codec.compress(data, length, batch.compressed);
+            data = batch.compressed.data();
+            length = batch.compressed.size();
+        }
+
+        int fragments = (mtu && length > mtu) ? int((length + mtu - 1) / mtu) : 1;
+        int firstFragment = i == 0 ? first.fragment : 0;
+        for (int f = firstFragment; f < fragments && batch.size < count; f++) {
+            int k = batch.size++;
+            size_t offset = mtu ? f * mtu : 0;
+            size_t size = fragments > 1 ? std::min(mtu, length - offset) : length;
+
+            DataUnit &unit = batch.units[k];
+            unit.index = first.index + k;
+            unit.line = first.line + i;
+            unit.lines = unitLines;
+            unit.fragment = f;
+            unit.last = f == fragments - 1;
+            batch.unitLines[k] = i;
+            batch.fromDisk[k] = fromDisk && f == firstFragment;
+            if (aggregation) batch.errorCodes[k] = errorCode.to_string();
+            else batch.errorCodes[k].assign(line, 0, 4);
+
+            ConvertStringToBits(data + offset, size, batch.payloads[k], true);
+            batch.parities[k] = core.checksum(batch.payloads[k]);
+            if (this->config.fec) FecEncode(batch.payloads[k]);
+        }
+        i += unitLines;
+    }
+
+    return batch.size;
+}
+
+template<class Core> int Protocol::sendDataFrames(const Core &core, const DataUnit &first, seqnum dataSequenceNumber, int count, int errorFreeIndex, bool timeout) {
+    PROFILE_SCOPE(PROF_SEND_FRAMES);
+
+    int prepared = this->prepareDataFrames(core, first, count);
+
+    float realTime = 0.0;
+    for (int i = 0; i < prepared; i++) {
+        seqnum sequence = core.modulus(int64_t(dataSequenceNumber) + i);
+        this->sendDataFrame(i, sequence, i == errorFreeIndex, realTime, timeout);
+
+        // Units sent before are being sent again.
+        this->senderInfo.dataFramesSent++;
+        if (first.index + i < this->senderInfo.nextNewUnit) {
+            this->senderInfo.retransmissions++;
+            this->senderInfo.bytesRetransmitted += this->senderInfo.batch.payloads[i].size();
+        }
+        else this->senderInfo.nextNewUnit = first.index + i + 1;
+
+        Timer* timer = this->createTimer(sequence);
+        this->scheduler->schedule(realTime + this->config.timeout, timer->msg);
+    }
+
+    return prepared;
+}
+
+template<class Core> Timer* Protocol::deleteTimers(const Core &core, seqnum ackSequence, bool prev) {
+    PROFILE_SCOPE(PROF_DELETE_TIMERS);
+
+    Timer* t = this->senderInfo.timers;
+
+    while (t) {
+        if ((seqnum)t->msg->ackSequence == core.modulus(ackSequence))
+            break;
+        t = t->next;
+    }
+
+    if (t) {
+
+        if (prev) {
+            this->senderInfo.timers = t->next;
+            if (this->senderInfo.timers) this->senderInfo.timers->prev = NULL;
+            else this->senderInfo.timersEnd = NULL;
+        } else {
+            if (t->prev) {
+                t->prev->next = NULL;
+                this->senderInfo.timersEnd = t->prev;
+            }
+            else this->senderInfo.timers = this->senderInfo.timersEnd = NULL;
+        }
+
+        Timer* temp;
+        while (t) {
+            temp = prev ? t->prev : t->next;
+            this->scheduler->cancel(t->msg);
+            delete t;
+            t = temp;
+        }
+    }
+
+    return this->senderInfo.timers;
+}
+
+// prev is true on ack, false on nack
+template<class Core> void Protocol::advanceWindowAndSendFrames(const Core &core, seqnum ackSequence, bool prev) {
+
+    seqnum oldWStart = this->senderInfo.wStart;
+
+    // Updating wCurrent with the (n)ack sequence number.
+    // This will be the sequence number of the next frame to send.
+    this->senderInfo.wStart = ackSequence;
+
+    // Updating the line offset with the units that we advanced wStart over.
+    int advanced = (int)core.seqDistance(oldWStart, this->senderInfo.wStart);
+    DataUnit start = this->unitAt(advanced);
+    std::deque<DataUnit> &window = this->senderInfo.window;
+    window.erase(window.begin(), window.begin() + std::min(advanced, (int)window.size()));
+    this->senderInfo.currentLineOffset = start.line;
+    this->senderInfo.currentFragment = start.fragment;
+    this->senderInfo.currentUnitOffset = start.index;
+
+    // Canceling the timeout for this acknowledgment.
+    // In case of ack: the timers for the preceding frames.
+    // In case of nack: the timers of all frames (the preceding are acknowledged, and the following are resent)
+    // and all the timeouts for ack preceding/following this one (accumulative n(ack))
+    if (this->senderInfo.timers) {
+        seqnum startingSeq = prev ? core.modulus(int64_t(ackSequence) - 1) : (seqnum)this->senderInfo.timers->msg->ackSequence;
+        this->deleteTimers(core, startingSeq, prev);
+    }
+
+    // Advancing wCurrent and sending new frames as much as our window can expand.
+    // errorFree is true for the first message to be sent in case of nack.
+    // Its delay is increased by 0.001 as per the document.
+    int errorFreeIndex = prev ? -1 : 0;
+
+    int inFlight = (int)core.seqDistance(this->senderInfo.wStart, this->senderInfo.wCurrent);
+    int framesToSend = this->sendableFrames(this->unitAt(inFlight), this->config.windowSize - inFlight);
+
+    // Log output
+    if (prev)
+        this->log("At time [%.3f], Node [%d] received ack with seq_num = [%u]. Advancing window and sending %d frames.", this->scheduler->getTime(), this->id,
+                ackSequence, framesToSend);
+    else
+        this->log("At time [%.3f], Node [%d] received nack with seq_num = [%u]. Resending %d frames, starting from seq_num = [%u]", this->scheduler->getTime(), this->id,
+                ackSequence, framesToSend, this->senderInfo.wCurrent);
+
+
+    if (framesToSend <= 0) return;
+    this->sendNewFrames(core, framesToSend, errorFreeIndex);
+}
+
+template<class Core> void Protocol::sendNewFrames(const Core &core, int framesToSend, int errorFreeIndex) {
+    std::deque<DataUnit> &window = this->senderInfo.window;
+    DataUnit next = this->unitAt((int)core.seqDistance(this->senderInfo.wStart, this->senderInfo.wCurrent));
+    int sent = this->sendDataFrames(core, next, this->senderInfo.wCurrent, framesToSend, errorFreeIndex, false);
+    this->senderInfo.wCurrent = core.modulus(int64_t(this->senderInfo.wCurrent) + sent);
+    window.insert(window.end(), this->senderInfo.batch.units.begin(), this->senderInfo.batch.units.begin() + sent);
+
+    if (sent < framesToSend) {
+        this->log("At time [%.3f], Node [%d] found no more lines to send. Checking if we should terminate now", this->scheduler->getTime(), this->id);
+        if (!this->checkTermination())
+            this->log("At time [%.3f], Node [%d] is waiting for outstanding acks to terminate.", this->scheduler->getTime(), this->id);
+    }
+}
+
+template<class Core> void Protocol::sender(const Core &core, Frame *msg, bool self) {
+
+    // If this is a self-message: either this is the initial self-message
+    // or this is a timeout. Either case, start sending all messages again that fall
+    // within the window.
+    if (self) {
+        bool initial = msg->frameType == START_FRAME;
+        seqnum timedoutSequenceNumber = (seqnum)msg->ackSequence;
+        if (!initial) this->log("At time [%.3f], Node [%d] timeout event for frame with seq_num = [%u]", this->scheduler->getTime(), this->id, timedoutSequenceNumber);
+
+        // The expired timer itself is deleted with the other timers below.
+        if (initial) delete msg;
+
+        // Cancel all timers starting from the timer that expired and onwards, i.e: all timers.
+        // Clarification: if a timer expired, it MUST have been the first timer in the window, by the very
+        // structure of the way acknowledgements are serially handled in the code.
+        if (this->senderInfo.timers) this->deleteTimers(core, this->senderInfo.timers->msg->ackSequence, false);
+
+        // If this is the message that caused the timeout, then send it error-free.
+        int errorFreeIndex = -1;
+        if (!initial && (int64_t)core.seqDistance(this->senderInfo.wStart, timedoutSequenceNumber) < this->config.windowSize)
+            errorFreeIndex = (int)core.seqDistance(this->senderInfo.wStart, timedoutSequenceNumber);
+
+        // While new units are stopped, only those sent before are resent.
+        DataUnit first = this->unitAt(0);
+        int count = this->sendableFrames(first, this->config.windowSize);
+        int sent = this->sendDataFrames(core, first, this->senderInfo.wStart, count, errorFreeIndex, true);
+        this->senderInfo.window.assign(this->senderInfo.batch.units.begin(), this->senderInfo.batch.units.begin() + sent);
+        this->senderInfo.started = true;
+
+        // The input may end within the window, even on the first frames when every line is
+        // aggregated into fewer frames than the window holds.
+        senderInfo.wCurrent = core.modulus(int64_t(senderInfo.wStart) + sent);
+        if (sent < count) this->checkTermination();
+    }
+
+    // We received an ACK or NACK.
+    else {
+        seqnum sequenceNumber = (seqnum)msg->ackSequence;
+
+        // An (n)ack can only acknowledge frames between the start of the window and the next frame
+        // to be sent. Anything else is a stale duplicate from before the window last moved.
+        if (core.seqDistance(this->senderInfo.wStart, sequenceNumber) > core.seqDistance(this->senderInfo.wStart, this->senderInfo.wCurrent)) {
+            this->log("At time [%.3f], Node [%d] ignored stale %s with seq_num = [%u]", this->scheduler->getTime(), this->id,
+                    msg->frameType == ACK_FRAME ? "ack" : "nack", sequenceNumber);
+            this->senderInfo.staleAcksDiscarded++;
+            delete msg;
+            return;
+        }
+
+        // An ack of the start of the window acknowledges nothing new. With GA = 1 it is dropped
+        // here, unless the window has room for more frames, instead of walking the timers.
+        if (this->config.gapAcks == GAP_ACK_ONCE && msg->frameType == ACK_FRAME && sequenceNumber == this->senderInfo.wStart) {
+            int inFlight = (int)core.seqDistance(this->senderInfo.wStart, this->senderInfo.wCurrent);
+            if (this->sendableFrames(this->unitAt(inFlight), this->config.windowSize - inFlight) <= 0) {
+                this->log("At time [%.3f], Node [%d] discarded duplicate ack with seq_num = [%u]", this->scheduler->getTime(), this->id, sequenceNumber);
+                this->senderInfo.staleAcksDiscarded++;
+                delete msg;
+                return;
+            }
+        }
+
+        switch (msg->frameType) {
+        case ACK_FRAME: {
+            this->advanceWindowAndSendFrames(core, sequenceNumber, true);
+            break;
+        }
+
+        case NACK_FRAME: {
+            std::deque<DataUnit> &window = this->senderInfo.window;
+            window.resize(std::min<size_t>(window.size(), core.seqDistance(this->senderInfo.wStart, sequenceNumber)));
+            this->senderInfo.wCurrent = sequenceNumber;
+            this->advanceWindowAndSendFrames(core, sequenceNumber, false);
+            break;
+        }
+
+        default: break;
+        }
+
+        delete msg;
+    }
+}
+
+template<class Core> void Protocol::sendGapAck(const Core &core, seqnum sequenceNumber) {
+    ReceiverInfo &r = this->receiverInfo;
+    double now = this->scheduler->getTime();
+
+    // Within one pass of the sender over its window, the out-of-order frames come further and
+    // further past the expected one. Any other one means the sender went back, on a timeout,
+    // and may be waiting for this very ack.
+    seqnum distance = core.seqDistance(r.expectedFrameSequence, sequenceNumber);
+    bool inSequence = r.gapOpen && distance > r.gapDistance;
+    r.gapDistance = distance;
+
+    // The first out-of-order frame after a loss opens a gap.
+    if (!r.gapOpen) {
+        r.gapOpen = true;
+        r.gapEpisodes++;
+    }
+    else if (this->config.gapAcks == GAP_ACK_ONCE && inSequence && (this->config.gapAckInterval <= 0 || now - r.gapAckedAt < this->config.gapAckInterval)) {
+        r.gapAcksSuppressed++;
+        return;
+    }
+
+    r.gapAckedAt = now;
+    r.gapAcksSent++;
+    this->sendAck(ACK_FRAME, false);
+}
+
+template<class Core> void Protocol::receiver(const Core &core, Frame *msg) {
+
+    // If not an in-order message, drop and send an ack with the sequence of the next expected frame sequence.
+    if ((seqnum)msg->dataSequence != this->receiverInfo.expectedFrameSequence) {
+        this->log("At time [%.3f], Node [%d] dropped out-of-order frame with seq_num = [%u]. Expecting seq_num = [%u]", this->getRealTime(this->receiverInfo.processedUntil), this->id, (seqnum)msg->dataSequence, this->receiverInfo.expectedFrameSequence);
+        this->sendGapAck(core, (seqnum)msg->dataSequence);
+        delete msg;
+        return;
+    }
+
+    // The expected frame has arrived, closing the gap if there was one.
+    this->receiverInfo.gapOpen = false;
+
+    // Correcting the payload first, with FEC. Errors detected but not corrected make the frame invalid
+    // even if they slip past the checksum.
+    bool correctable = true;
+    if (this->config.fec) {
+        FecResult fec = FecDecode(msg->payload);
+        if (fec.correctedBits) {
+            this->receiverInfo.framesCorrected++;
+            this->receiverInfo.bitsCorrected += fec.correctedBits;
+        }
+        if (fec.uncorrectable) this->receiverInfo.framesUncorrectable++;
+        correctable = !fec.uncorrectable;
+    }
+
+    // Verify the checksum of the message
+    bool valid = correctable && core.verifyChecksum(msg->payload, msg->parity);
+    this->receiverInfo.expectedFrameSequence = core.modulus(int64_t(this->receiverInfo.expectedFrameSequence) + (valid ? 1 : 0));
+
+    // A fragment is held back until the last fragment of its line completes it. A line is
+    // only uploaded from its own fragments in order: a stale fragment that takes the sequence
+    // number expected does not continue the line, and is discarded with the partial line.
+    ReceiverInfo &r = this->receiverInfo;
+    bool fragment = msg->moreFragments || msg->fragmentIndex > 0;
+    bool complete = valid && !msg->moreFragments;
+    if (valid && fragment) {
+        bool starts = msg->fragmentIndex == 0;
+        bool continues = msg->fragmentLine == r.reassemblyLine && msg->fragmentIndex == r.reassemblyNext;
+        if (!continues) this->discardReassembly();
+        if (starts || continues) {
+            r.reassembly += ConvertBitsToString(msg->payload, true);
+            r.reassemblyLine = msg->fragmentLine;
+            r.reassemblyNext = msg->fragmentIndex + 1;
+        }
+        else {
+            this->log("At time [%.3f], Node [%d] discarded fragment [%d] of line [%d] with seq_num = [%u]",
+                    this->getRealTime(r.processedUntil), this->id, msg->fragmentIndex, msg->fragmentLine, (seqnum)msg->dataSequence);
+            r.fragmentsDiscarded++;
+            complete = false;
+        }
+    }
+    else if (valid) this->discardReassembly();
+
+    if (complete) {
+        std::string payload;
+        if (fragment) {
+            payload.swap(r.reassembly);
+            r.reassemblyLine = -1;
+        }
+        else payload = ConvertBitsToString(msg->payload, true);
+
+        // A payload that fails to decompress is uploaded as it was received.
+        if (this->config.compression) {
+            std::string decompressed;
+            if (this->codec.decompress(payload, decompressed)) payload.swap(decompressed);
+        }
+
+        if (!this->config.aggregationLimit) this->uploadPayload(payload, (seqnum)msg->dataSequence);
+        else {
+            // Splitting the sub-records; a malformed remainder is uploaded as it is.
+            std::string record;
+            for (size_t offset = 0; offset < payload.size(); ) {
+                if (!NextSubRecord(payload, offset, record)) {
+                    record.assign(payload, offset, std::string::npos);
+                    offset = payload.size();
+                }
+                this->uploadPayload(record, (seqnum)msg->dataSequence);
+            }
+        }
+    }
+    this->sendAck(int(valid));
+
+    delete msg;
+    return;
+}
+
+#endif /* PROTOCOLPATHS_H_ */
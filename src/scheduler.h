@@ -0,0 +1,58 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "frame.h"
+
+// The services the protocol needs from a discrete-event simulation kernel. Implemented by
+// the OMNeT++ Node module and by the headless engine, so the same protocol code runs in both.
+// Frames passed to schedule() and sendToPeer() are owned by the scheduler until they are
+// handed back to the protocol.
+class Scheduler {
+public:
+    virtual ~Scheduler() {}
+
+    // The current simulation time.
+    virtual double getTime() = 0;
+
+    // Hands the frame back to the protocol as a self-message at the given time.
+    virtual void schedule(double time, Frame* frame) = 0;
+
+    // Cancels a frame scheduled with schedule() and deletes it.
+    virtual void cancel(Frame* frame) = 0;
+
+    // Delivers the frame to the peer node after the given delay.
+    virtual void sendToPeer(Frame* frame, double delay) = 0;
+
+    // Random numbers drawn from the RNG with the given index.
+    virtual double uniformRandom(double a, double b, int rng = 0) = 0;
+    virtual int intuniformRandom(int a, int b, int rng = 0) = 0;
+
+    // Whether there is an event log to write to; the protocol formats no lines otherwise.
+    virtual bool isLogEnabled() const = 0;
+
+    // Writes a formatted, NUL-terminated line of the given length, without its newline, to the event log.
+    virtual void writeLog(const char* line, size_t length) = 0;
+
+    // Records an end-of-run statistic.
+    virtual void recordResult(const char* name, double value) = 0;
+
+    // Ends the run, called once the sender has nothing left to do.
+    virtual void endRun() = 0;
+};
+
+#endif /* SCHEDULER_H_ */
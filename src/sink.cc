@@ -0,0 +1,164 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include <algorithm>
+#include <stdexcept>
+#include "sink.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t HashBytes(uint64_t hash, const char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+void DeliverySink::deliver(const char* data, size_t length) {
+    this->hash = HashBytes(HashBytes(this->hash, data, length), "\n", 1);
+    this->records++;
+    this->bytes += length;
+    this->write(data, length);
+}
+
+void DeliverySink::resume(uint64_t hash, long records, long bytes) {
+    this->hash = hash;
+    this->records = records;
+    this->bytes = bytes;
+}
+
+DeliverySink* DeliverySink::create(const std::string &output, bool resuming) {
+    if (output == ":memory:") return new MemorySink();
+    return new FileSink(output, resuming);
+}
+
+void MemorySink::write(const char* data, size_t length) {
+    this->contents.append(data, length);
+    this->contents.push_back('\n');
+}
+
+FileSink::FileSink(const std::string &fileName, bool resuming, size_t bufferSize) : fileName(fileName), buffer(bufferSize)
+{
+#ifdef _WIN32
+    this->out.open(fileName, resuming ? std::ios::binary | std::ios::in | std::ios::out : std::ios::binary);
+    if (!this->out.good())
+#else
+    this->fd = open(fileName.c_str(), O_WRONLY | O_CREAT | (resuming ? 0 : O_TRUNC), 0644);
+    if (this->fd < 0)
+#endif
+        throw std::runtime_error("Error opening the delivery file: " + fileName);
+}
+
+FileSink::~FileSink() {
+    // Errors surface through flush() at the end of the run; not from here.
+    try { this->flush(); } catch (std::exception&) {}
+#ifndef _WIN32
+    close(this->fd);
+#endif
+}
+
+// Writes the buffer followed by `data`, and empties the buffer.
+void FileSink::writeOut(const char* data, size_t length) {
+#ifdef _WIN32
+    this->out.write(this->buffer.data(), this->used);
+    this->out.write(data, length);
+    if (!this->out.good())
+        throw std::runtime_error("Error writing the delivery file: " + this->fileName);
+#else
+    struct iovec iov[2] = {{this->buffer.data(), this->used}, {(void*)data, length}};
+    int count = length ? 2 : 1;
+    struct iovec* next = iov;
+    while (count) {
+        ssize_t written = writev(this->fd, next, count);
+        if (written < 0)
+            throw std::runtime_error("Error writing the delivery file: " + this->fileName);
+
+        // Short writes continue where they stopped.
+        while (count && (size_t)written >= next->iov_len) {
+            written -= next->iov_len;
+            next++;
+            count--;
+        }
+        if (count) {
+            next->iov_base = (char*)next->iov_base + written;
+            next->iov_len -= written;
+        }
+    }
+#endif
+    this->used = 0;
+}
+
+void FileSink::write(const char* data, size_t length) {
+    if (this->used + length + 1 > this->buffer.size()) {
+        // A record that does not fit an empty buffer is written as it is.
+        if (length + 1 > this->buffer.size()) {
+            this->writeOut(data, length);
+            this->buffer[this->used++] = '\n';
+            return;
+        }
+        this->writeOut(NULL, 0);
+    }
+    std::copy(data, data + length, this->buffer.begin() + this->used);
+    this->used += length;
+    this->buffer[this->used++] = '\n';
+}
+
+void FileSink::flush() {
+    if (this->used) this->writeOut(NULL, 0);
+#ifdef _WIN32
+    this->out.flush();
+#endif
+}
+
+void FileSink::resume(uint64_t hash, long records, long bytes) {
+    DeliverySink::resume(hash, records, bytes);
+    this->used = 0;
+
+    long length = bytes + records;
+#ifdef _WIN32
+    this->out.seekp(length);
+    if (!this->out.good())
+#else
+    if (ftruncate(this->fd, length) != 0 || lseek(this->fd, length, SEEK_SET) < 0)
+#endif
+        throw std::runtime_error("Error resuming the delivery file: " + this->fileName);
+}
+
+uint64_t ExpectedDeliveryHash(TextFile &input) {
+    input.OpenFile();
+
+    // Lines are only passed through once; keep just one of them buffered.
+    input.SetBufferSize(1);
+
+    std::vector<std::string> lines;
+    std::vector<bool> readFromBuffer;
+    uint64_t hash = DeliverySink::FNV_OFFSET;
+    int n = 0, count;
+    while ((count = input.ReadLines(n, 1024, lines, readFromBuffer)) > 0) {
+        for (int i = 0; i < count; i++) {
+            size_t prefix = std::min<size_t>(5, lines[i].size());
+            hash = HashBytes(HashBytes(hash, lines[i].data() + prefix, lines[i].size() - prefix), "\n", 1);
+        }
+        n += count;
+    }
+    return hash;
+}
@@ -0,0 +1,95 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef SINK_H_
+#define SINK_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "util.h"
+
+// The network layer of the receiver: the payloads it delivers, in order, one record per
+// line. A running hash of everything delivered is kept, so that the delivered data can
+// be checked against the sender's input at the end of the run.
+class DeliverySink {
+    uint64_t hash = FNV_OFFSET;
+    long records = 0;
+    long bytes = 0;
+protected:
+    virtual void write(const char* data, size_t length) = 0;
+public:
+    static const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+
+    virtual ~DeliverySink() {}
+
+    // Appends a delivered payload, followed by a newline.
+    void deliver(const char* data, size_t length);
+
+    // Writes out anything still buffered.
+    virtual void flush() {}
+
+    // FNV-1a hash of the delivered stream, records with their newlines.
+    uint64_t getHash() const { return hash; }
+    long getRecords() const { return records; }
+    long getBytes() const { return bytes; }
+
+    // Continues after the given number of records, bytes and hash, for a resumed run.
+    virtual void resume(uint64_t hash, long records, long bytes);
+
+    // A file sink for the path, or a memory sink for ":memory:". A file is kept
+    // rather than truncated when the sink is going to be resumed.
+    static DeliverySink* create(const std::string &output, bool resuming = false);
+};
+
+// Keeps the delivered stream in memory, for benchmarks and tests of the protocol
+// without disk writes.
+class MemorySink : public DeliverySink {
+protected:
+    virtual void write(const char* data, size_t length) override;
+public:
+    std::string contents;
+};
+
+// Appends the delivered stream to a file. Records are gathered in a buffer and
+// written with a single writev() once it fills up; a record larger than the buffer
+// goes out in the same call, without being copied.
+class FileSink : public DeliverySink {
+    std::string fileName;
+    std::vector<char> buffer;
+    size_t used = 0;
+#ifdef _WIN32
+    std::ofstream out;
+#else
+    int fd = -1;
+#endif
+    void writeOut(const char* data, size_t length);
+protected:
+    virtual void write(const char* data, size_t length) override;
+public:
+    FileSink(const std::string &fileName, bool resuming = false, size_t bufferSize = 1 << 16);
+    virtual ~FileSink();
+    virtual void flush() override;
+
+    // Also cuts the file back to the resumed length and appends after it.
+    virtual void resume(uint64_t hash, long records, long bytes) override;
+};
+
+// The hash a DeliverySink ends up with when all the lines of the input are delivered:
+// the payloads of the lines, without their error code prefix.
+uint64_t ExpectedDeliveryHash(TextFile &input);
+
+#endif /* SINK_H_ */
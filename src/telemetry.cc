@@ -0,0 +1,81 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#include <cstdio>
+#include <stdexcept>
+#include "telemetry.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+long ResidentSetSize()
+{
+#if defined(__linux__)
+    // The second field of statm is the number of resident pages.
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) return -1;
+    long size, resident;
+    int fields = fscanf(statm, "%ld %ld", &size, &resident);
+    fclose(statm);
+    if (fields != 2) return -1;
+    return resident * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+void TelemetryWriter::open(const std::string &file)
+{
+    this->out.open(file, std::ios::out | std::ios::trunc);
+    if (!this->out.good())
+        throw std::runtime_error("Error opening telemetry file " + file);
+    this->start = this->last = std::chrono::steady_clock::now();
+    this->lastEvents = 0;
+}
+
+void TelemetryWriter::write(double simTime, uint64_t events, const Protocol* const nodes[2])
+{
+    auto now = std::chrono::steady_clock::now();
+    double wallTime = std::chrono::duration<double>(now - this->start).count();
+    double interval = std::chrono::duration<double>(now - this->last).count();
+    double rate = interval > 0 ? (events - this->lastEvents) / interval : 0;
+    this->last = now;
+    this->lastEvents = events;
+
+    char line[256];
+    snprintf(line, sizeof(line), "{\"simTime\":%.6f,\"wallTime\":%.3f,\"events\":%llu,\"eventsPerSecond\":%.1f,\"rss\":",
+            simTime, wallTime, (unsigned long long)events, rate);
+    this->out << line;
+    long rss = ResidentSetSize();
+    if (rss >= 0) this->out << rss;
+    else this->out << "null";
+
+    this->out << ",\"nodes\":[";
+    for (int i = 0; i < 2; i++) {
+        if (i) this->out << ",";
+        if (!nodes[i]) {
+            this->out << "null";
+            continue;
+        }
+        ProtocolTelemetry t = nodes[i]->telemetry();
+        snprintf(line, sizeof(line), "{\"sender\":%s,\"framesInFlight\":%ld,\"timers\":%ld,\"senderBacklog\":%.6f,"
+                "\"receiverBacklog\":%.6f,\"transmitQueue\":%ld,\"bufferedLines\":%ld}",
+                nodes[i]->isSenderNode() ? "true" : "false", t.framesInFlight, t.timers, t.senderBacklog,
+                t.receiverBacklog, t.transmitQueue, t.bufferedLines);
+        this->out << line;
+    }
+    this->out << "]}" << std::endl;
+}
@@ -0,0 +1,53 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "protocol.h"
+
+// The resident set size of the process in bytes, or -1 where it is not known
+// (it is read from /proc/self/statm, on Linux only).
+long ResidentSetSize();
+
+// Periodic telemetry of a run, written as newline-delimited JSON so that a dashboard
+// can tail the file while the run goes on. Each line has the simulated and wall-clock
+// time, the event count, the event rate since the previous line, the resident set size
+// and the live state of both nodes, for example:
+//
+//   {"simTime":120.5,"wallTime":0.031,"events":812,"eventsPerSecond":26193.5,"rss":4136960,
+//    "nodes":[{"sender":false,"framesInFlight":0,...},{"sender":true,"framesInFlight":3,...}]}
+//
+// A node without a protocol yet is written as null, and an unknown RSS as null.
+class TelemetryWriter {
+    std::ofstream out;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point last;
+    uint64_t lastEvents = 0;
+public:
+    // Creates or truncates the file and starts the wall clock.
+    // Throws std::runtime_error if it cannot be opened.
+    void open(const std::string &file);
+    bool isOpen() const { return out.is_open(); }
+
+    // Writes and flushes one line for the given time, event count and nodes.
+    void write(double simTime, uint64_t events, const Protocol* const nodes[2]);
+};
+
+#endif /* TELEMETRY_H_ */
@@ -15,22 +15,182 @@
 
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
 #include "util.h"
+#include "prefetch.h"
+#include "profiler.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void LinkConfig::Validate() {
+
+    // The sequence space is decoupled from the window size when SN is set; otherwise
+    // it is the minimal WS+1 space. Go-Back-N needs at least one unused sequence number.
+    if (this->windowSize < 1)
+        throw std::runtime_error("The window size WS must be at least 1.");
+    if (this->sequenceBits < 0 || this->sequenceBits > 32)
+        throw std::runtime_error("The sequence number width SN must be between 0 and 32 bits.");
+
+    this->sequenceSpace = this->sequenceBits ? (int64_t(1) << this->sequenceBits) : int64_t(this->windowSize) + 1;
+    if (this->windowSize >= this->sequenceSpace)
+        throw std::runtime_error("The window size WS must be smaller than the sequence space 2^SN.");
+    if (this->mtu < 0)
+        throw std::runtime_error("The MTU must not be negative.");
+    if (this->aggregationLimit < 0)
+        throw std::runtime_error("The aggregation limit AG must not be negative.");
+    if (this->fec < 0 || this->fec > 1)
+        throw std::runtime_error("FEC must be 0 (none) or 1 (SECDED).");
+    if (this->checksum < 0 || this->checksum > 1)
+        throw std::runtime_error("CS must be 0 (sum) or 1 (CRC-8).");
+    if (this->gapAcks < GAP_ACK_EVERY || this->gapAcks > GAP_ACK_ONCE)
+        throw std::runtime_error("GA must be 0 (every out-of-order frame) or 1 (once per gap).");
+    if (this->gapAckInterval < 0)
+        throw std::runtime_error("The gap ack interval GI must not be negative.");
+    if (this->readAhead < 0)
+        throw std::runtime_error("The read-ahead RA must not be negative.");
+
+    // The link model.
+    if (this->datarate < 0)
+        throw std::runtime_error("The datarate DR must not be negative.");
+    if (this->propagationDelay < 0)
+        throw std::runtime_error("The propagation delay PD must not be negative.");
+    if (this->queueLimit < 0)
+        throw std::runtime_error("The queue limit QL must not be negative.");
+
+    // The channel error model.
+    if (this->ackLossProb < 0 || this->ackLossProb > 1)
+        throw std::runtime_error("The ack loss probability LP must be between 0 and 1.");
+    if (this->bitErrorRate < 0 || this->bitErrorRate > 1)
+        throw std::runtime_error("The bit error rate BER must be between 0 and 1.");
+    if (this->goodToBadProb < 0 || this->goodToBadProb > 1)
+        throw std::runtime_error("The good-to-bad probability GB must be between 0 and 1.");
+    if (this->badToGoodProb < 0 || this->badToGoodProb > 1)
+        throw std::runtime_error("The bad-to-good probability BG must be between 0 and 1.");
+    if (this->goodLossProb < 0 || this->goodLossProb > 1)
+        throw std::runtime_error("The good-state loss probability LG must be between 0 and 1.");
+    if (this->badLossProb < 0 || this->badLossProb > 1)
+        throw std::runtime_error("The bad-state loss probability LB must be between 0 and 1.");
+    if (this->randomDuplicationProb < 0 || this->randomDuplicationProb > 1)
+        throw std::runtime_error("The duplication probability DP must be between 0 and 1.");
+    if (this->reorderProb < 0 || this->reorderProb > 1)
+        throw std::runtime_error("The reordering probability RP must be between 0 and 1.");
+    if (this->errorRng < 0)
+        throw std::runtime_error("The error model RNG ER must not be negative.");
+}
+
+bool SetLinkParameter(LinkConfig &config, const std::string &name, const char* value) {
+    double v = atof(value);
+    if (name == "WS") config.windowSize = (int)v;
+    else if (name == "TO") config.timeout = v;
+    else if (name == "PT") config.processingTime = v;
+    else if (name == "TD") config.transmissionDelay = v;
+    else if (name == "ED") config.errorDelay = v;
+    else if (name == "DD") config.duplicationDelay = v;
+    else if (name == "LP") config.ackLossProb = v;
+    else if (name == "SN") config.sequenceBits = (int)v;
+    else if (name == "DR") config.datarate = v;
+    else if (name == "PD") config.propagationDelay = v;
+    else if (name == "QL") config.queueLimit = (int)v;
+    else if (name == "MTU") config.mtu = (int)v;
+    else if (name == "AG") config.aggregationLimit = (int)v;
+    else if (name == "FEC") config.fec = (int)v;
+    else if (name == "CS") config.checksum = (int)v;
+    else if (name == "GA") config.gapAcks = (int)v;
+    else if (name == "GI") config.gapAckInterval = v;
+    else if (name == "RA") config.readAhead = (int)v;
+    else if (name == "LZ") config.compression = v != 0 || strcmp(value, "true") == 0;
+    else if (name == "BER") config.bitErrorRate = v;
+    else if (name == "GB") config.goodToBadProb = v;
+    else if (name == "BG") config.badToGoodProb = v;
+    else if (name == "LG") config.goodLossProb = v;
+    else if (name == "LB") config.badLossProb = v;
+    else if (name == "DP") config.randomDuplicationProb = v;
+    else if (name == "RP") config.reorderProb = v;
+    else if (name == "ER") config.errorRng = (int)v;
+    else if (name == "DO") config.deliveryOutput = value;
+    else return false;
+    return true;
+}
+
+MappedInput::MappedInput(std::string fileName) : fileName(fileName)
+{
+#ifndef _WIN32
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Error opening the file: " + fileName);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            this->data = (const char*)p;
+            this->size = st.st_size;
+            this->mapped = true;
+        }
+    }
+    close(fd);
+#endif
+
+    if (!this->mapped) {
+        std::ifstream in(fileName, std::ios::binary);
+        if (!in.good())
+            throw std::runtime_error("Error opening the file: " + fileName);
+        this->contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        this->data = this->contents.data();
+        this->size = this->contents.size();
+    }
+
+    // The same index as TextFile::OpenFile: empty lines are skipped, and a last line
+    // without a newline ends at -1, where the stream would be at its end.
+    size_t pos = 0;
+    this->lineBeginnings.push_back(0);
+    while (pos < this->size) {
+        const char* newline = (const char*)memchr(this->data + pos, '\n', this->size - pos);
+        size_t end = newline ? newline - this->data : this->size;
+        bool empty = end == pos;
+        pos = newline ? end + 1 : this->size;
+        if (empty) continue;
+        this->lineBeginnings.push_back(newline ? (int64_t)pos : -1);
+    }
+}
 
-int Info::windowSize = 0;
-double Info::timeout = 0;
-double Info::processingTime = 0;
-double Info::transmissionDelay = 0;
-double Info::errorDelay = 0;
-double Info::duplicationDelay = 0;
-double Info::ackLossProb = 0;
-std::ofstream Info::log;
+MappedInput::~MappedInput() {
+#ifndef _WIN32
+    if (this->mapped) munmap((void*)this->data, this->size);
+#endif
+}
+
+void MappedInput::ReadLine(int N, std::string &s) const {
+    size_t begin = this->lineBeginnings[N];
+    const char* newline = (const char*)memchr(this->data + begin, '\n', this->size - begin);
+    size_t end = newline ? newline - this->data : this->size;
+    if (end > begin) end--; // Excluding new line
+    s.assign(this->data + begin, end - begin);
+}
 
 TextFile::TextFile(std::string fileName) : fileName(fileName)
 {
 }
 
+TextFile::TextFile(std::shared_ptr<const MappedInput> input) : mappedInput(input)
+{
+}
+
 void TextFile::OpenFile()  {
+    PROFILE_SCOPE(PROF_OPEN_FILE);
+    if (this->mappedInput) return;
+
     this->file_stream.open(this->fileName, std::ios::binary);
     if (!this->file_stream.good())
         throw std::runtime_error("Error opening the file: " + this->fileName);
@@ -43,45 +203,161 @@ void TextFile::OpenFile()  {
         lineBeginnings.push_back(file_stream.tellg());
     }
 }
+void TextFile::StartPrefetch(int lines) {
+    if (this->mappedInput || lines <= 0) return;
+    int first = this->bufferedLines.end ? this->bufferedLines.end->N + 1 : 0;
+    this->prefetcher.reset(new LinePrefetcher(this->fileName, this->lineBeginnings, first, lines));
+}
+
+long TextFile::PrefetchHits() const {
+    return this->prefetcher ? this->prefetcher->hits : 0;
+}
+
+long TextFile::PrefetchMisses() const {
+    return this->prefetcher ? this->prefetcher->misses : 0;
+}
+
 void TextFile::SetBufferSize(int bufferSize) {
-    this->bufferedLines.availSpace = this->bufferedLines.size = bufferSize;
+    // Lines already buffered count against the new size; the oldest go if it shrinks.
+    int count = this->BufferedLineCount();
+    for (; count > bufferSize; count--) this->EvictOldestLine();
+    this->bufferedLines.size = bufferSize;
+    this->bufferedLines.availSpace = bufferSize - count;
 }
-ReadLineResult TextFile::ReadNthLine(int N, std::string &s) {
+int TextFile::LineCount() const {
+    return this->mappedInput ? this->mappedInput->LineCount() : (int)lineBeginnings.size() - 1;
+}
+
+// Reads the Nth line from the shared input or from disk, seeking first unless
+// `positioned` says the file is already at it.
+void TextFile::ReadLineFromSource(int N, std::string &s, bool &positioned) {
+    if (this->mappedInput) {
+        this->mappedInput->ReadLine(N, s);
+        return;
+    }
+
+    // A line read ahead leaves the file where it was.
+    if (this->prefetcher && this->prefetcher->take(N, s)) {
+        positioned = false;
+        return;
+    }
 
-    if (N >= lineBeginnings.size() - 1) return ReadLineResult{false, false};
+    if (!positioned) {
+        // Clear EOF and error flags
+        this->file_stream.clear();
+        this->file_stream.seekg(lineBeginnings[N]);
+        positioned = true;
+    }
+
+    std::getline(this->file_stream, s);
+
+    // The next line only follows on when no empty line, left out of the index, comes between.
+    positioned = (std::streamoff)lineBeginnings[N] + (std::streamoff)s.size() + 1 == (std::streamoff)lineBeginnings[N + 1];
+    if (!s.empty()) s.pop_back(); // Excluding new line
+}
+
+ReadLineResult TextFile::ReadNthLine(int N, std::string &s) {
+    PROFILE_SCOPE(PROF_READ_NTH_LINE);
 
-    // Clear EOF and error flags
-    this->file_stream.clear();
-    this->file_stream.seekg(lineBeginnings[N]);
+    if (N >= LineCount()) return ReadLineResult{false, false};
 
-    bool isBuffered = false;
-    if (this->bufferedLines.start)
-        if (N >= this->bufferedLines.start->N && N <= this->bufferedLines.end->N)
-           isBuffered = true;
+    auto buffered = this->bufferedIndex.find(N);
+    bool isBuffered = buffered != this->bufferedIndex.end();
 
     if (isBuffered) {
-        TextLine *t = GetElementFromLinkedList<TextLine, int>(&this->bufferedLines, N);
-        s = t->line;
+        s = buffered->second->line;
     } else {
+        TextLine* t = this->BufferLine(N);
+        bool positioned = false;
+        ReadLineFromSource(N, t->line, positioned);
+        s = t->line;
+    }
 
-        InsertAtEndOfLinkedList<TextLine, int>(&this->bufferedLines);
+    return ReadLineResult{true, isBuffered};
+}
+
+int TextFile::ReadLines(int N, int count, std::vector<std::string> &lines, std::vector<bool> &readFromBuffer, int offset) {
+    PROFILE_SCOPE(PROF_READ_LINES);
+
+    int available = std::max(0, std::min(count, LineCount() - N));
+    if ((int)lines.size() < offset + available) lines.resize(offset + available);
+    readFromBuffer.resize(offset);
+    readFromBuffer.resize(offset + available, false);
+
+    // The buffered lines are looked up by number: after a rewind they are not in line order.
+    bool positioned = false;
+
+    for (int i = 0; i < available; i++) {
+        int n = N + i;
 
-        this->bufferedLines.end->N = N;
-        std::getline(this->file_stream, this->bufferedLines.end->line);
-        this->bufferedLines.end->line = this->bufferedLines.end->line.substr(0, this->bufferedLines.end->line.length() - 1); // Excluding new line
-        s = this->bufferedLines.end->line;
+        auto buffered = this->bufferedIndex.find(n);
+        if (buffered != this->bufferedIndex.end()) {
+            lines[offset + i] = buffered->second->line;
+            readFromBuffer[offset + i] = true;
+            positioned = false;
+            continue;
+        }
+
+        TextLine* t = this->BufferLine(n);
+        ReadLineFromSource(n, t->line, positioned);
+        lines[offset + i] = t->line;
     }
 
-    return ReadLineResult{true, isBuffered};
+    return available;
+}
+
+std::vector<int> TextFile::BufferedLines() const {
+    std::vector<int> lines;
+    for (TextLine* t = this->bufferedLines.start; t; t = t->next) lines.push_back(t->N);
+    return lines;
+}
+
+int TextFile::BufferedLineCount() const {
+    return (int)this->bufferedIndex.size();
+}
+
+TextLine* TextFile::BufferLine(int N) {
+    if (this->bufferedLines.size != -1 && this->bufferedLines.availSpace == 0) this->EvictOldestLine();
+    InsertAtEndOfLinkedList<TextLine, int>(&this->bufferedLines);
+    this->bufferedLines.end->N = N;
+    this->bufferedIndex[N] = this->bufferedLines.end;
+    return this->bufferedLines.end;
+}
+
+void TextFile::EvictOldestLine() {
+    this->bufferedIndex.erase(this->bufferedLines.start->N);
+    DeleteElementFromLinkedList<TextLine, int>(&this->bufferedLines, this->bufferedLines.start->N);
+}
+
+void TextFile::RestoreBufferedLines(std::vector<int> const& lines) {
+    for (int n : lines) {
+        if (n < 0 || n >= LineCount())
+            throw std::runtime_error("Buffered line out of range: " + std::to_string(n));
+
+        // A line is buffered once, as it is when it is read.
+        if (this->bufferedIndex.count(n)) continue;
+
+        TextLine* t = this->BufferLine(n);
+        bool positioned = false;
+        ReadLineFromSource(n, t->line, positioned);
+    }
 }
 
 TextFile::TextFile() {
 }
 
 TextFile::~TextFile() {
+    // The worker of the prefetcher goes first; it reads the file, not the buffered lines.
+    this->prefetcher.reset();
+    for (TextLine* t = this->bufferedLines.start; t; ) {
+        TextLine* next = t->next;
+        delete t;
+        t = next;
+    }
 }
 
 vecBitset8 ConvertStringToBits(std::string const &message, bool frame) {
+    PROFILE_SCOPE(PROF_STRING_TO_BITS);
 
     vecBitset8 bytes;
 
@@ -95,7 +371,22 @@ vecBitset8 ConvertStringToBits(std::string const &message, bool frame) {
     return bytes;
 }
 
+void ConvertStringToBits(const char* message, size_t length, vecBitset8 &bytes, bool frame) {
+    PROFILE_SCOPE(PROF_STRING_TO_BITS);
+
+    bytes.clear();
+
+    if (frame) bytes.push_back(bitset8('$'));
+    for (size_t i = 0; i < length; i++) {
+        const char &c = message[i];
+        if (frame && (c == '$' || c == '/')) bytes.push_back(bitset8('/'));
+        bytes.push_back(bitset8(c));
+    }
+    if (frame) bytes.push_back(bitset8('$'));
+}
+
 std::string ConvertBitsToString(vecBitset8 const& bytes, bool deframe) {
+    PROFILE_SCOPE(PROF_BITS_TO_STRING);
 
     std::string message;
     message.reserve(bytes.size()+1);
@@ -115,7 +406,34 @@ std::string ConvertBitsToString(vecBitset8 const& bytes, bool deframe) {
 }
 
 
+size_t SubRecordSize(size_t length) {
+    size_t digits = 1;
+    for (size_t n = length; n >= 10; n /= 10) digits++;
+    return digits + 1 + length;
+}
+
+void AppendSubRecord(std::string &packet, const char* record, size_t length) {
+    char digits[24];
+    int n = snprintf(digits, sizeof(digits), "%zu:", length);
+    packet.append(digits, n);
+    packet.append(record, length);
+}
+
+bool NextSubRecord(std::string const& packet, size_t &offset, std::string &record) {
+    size_t length = 0, i = offset;
+    for (; i < packet.size() && isdigit((unsigned char)packet[i]); i++) {
+        length = length * 10 + (packet[i] - '0');
+        if (length > packet.size()) return false;
+    }
+    if (i == offset || i == packet.size() || packet[i] != ':' || packet.size() - i - 1 < length) return false;
+
+    record.assign(packet, i + 1, length);
+    offset = i + 1 + length;
+    return true;
+}
+
 bool VerifyChecksum(vecBitset8 const& bytes, bitset8 const& checksum) {
+    PROFILE_SCOPE(PROF_VERIFY_CHECKSUM);
 
     bitset8 calculatedChecksum = CalculateChecksum(bytes);
     if (bitset8(calculatedChecksum ^ checksum).count() == 0)
@@ -126,6 +444,7 @@ bool VerifyChecksum(vecBitset8 const& bytes, bitset8 const& checksum) {
 
 
 bitset8 CalculateChecksum(vecBitset8 const &bytes) {
+    PROFILE_SCOPE(PROF_CALCULATE_CHECKSUM);
 
     std::bitset<9> intermediate(0);
     bitset8 result(0);
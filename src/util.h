@@ -19,10 +19,18 @@
 #include <fstream>
 #include <vector>
 #include <bitset>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
 
 typedef std::bitset<8> bitset8;
 typedef std::vector<bitset8> vecBitset8;
 
+// Sequence numbers are unsigned and at most 32 bits wide; arithmetic on them
+// is done in a wider signed type and reduced into the sequence space.
+typedef uint32_t seqnum;
+
 // Singly-linked list node for buffered text lines.
 struct TextLine {
 
@@ -53,36 +61,182 @@ struct linkedList {
     int availSpace = -1;
 };
 
-class Info {
+// Count, mean and extremes of a series of samples.
+struct RunningStat {
+    long count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+
+    void collect(double x) {
+        if (!count || x < min) min = x;
+        if (!count || x > max) max = x;
+        count++;
+        sum += x;
+    }
+    double mean() const { return count ? sum / count : 0; }
+};
+
+// The receiver acknowledges every out-of-order frame, or a gap in the frames once.
+#define GAP_ACK_EVERY 0
+#define GAP_ACK_ONCE 1
+
+// The parameters of one link and its two nodes, read from NED by each node.
+// The defaults are those of package.ned.
+struct LinkConfig {
+
+    // Checks the parameters and derives the sequence space from them.
+    // Throws std::runtime_error on an invalid combination.
+    void Validate();
+
+    int windowSize = 3;
+    double timeout = 10.0;
+    double processingTime = 0.5;
+    double transmissionDelay = 1.0;
+    double errorDelay = 4.0;
+    double duplicationDelay = 0.1;
+    double ackLossProb = 0.3;
+
+    // Width of the sequence number field in bits (0 means the minimal WS+1 space),
+    // and the resulting number of distinct sequence numbers.
+    int sequenceBits = 0;
+    int64_t sequenceSpace = 4;
+
+    // Link model: datarate in bit/s (0 for the fixed transmission delay),
+    // propagation delay, and transmit queue limit in frames (0 for unbounded).
+    double datarate = 0;
+    double propagationDelay = 0;
+    int queueLimit = 0;
+
+    // Largest payload of a data frame in bytes; longer lines are sent as fragments.
+    // 0 sends every line in one frame.
+    int mtu = 0;
+
+    // Largest payload in bytes that consecutive lines are aggregated into, as
+    // length-prefixed sub-records; 0 for no aggregation.
+    int aggregationLimit = 0;
+
+    // Lines of the sender's input read ahead on a worker thread, 0 for none; see LinePrefetcher.
+    int readAhead = 0;
+
+    // Whether the payloads are compressed, see PayloadCodec.
+    bool compression = false;
+
+    // Forward error correction of the data frames: FEC_NONE or FEC_SECDED, see fec.h.
+    int fec = 0;
+
+    // The checksum of the data frames: CHECKSUM_SUM or CHECKSUM_CRC8, see checksum.h.
+    int checksum = 0;
+
+    // Acks of out-of-order frames: GAP_ACK_EVERY or GAP_ACK_ONCE, and with GAP_ACK_ONCE the
+    // interval after which the gap is acknowledged again (0 for once per gap).
+    int gapAcks = 0;
+    double gapAckInterval = 0;
+
+    // Stochastic channel error model, see ChannelErrorModel.
+    double bitErrorRate = 0;
+    double goodToBadProb = 0;
+    double badToGoodProb = 1;
+    double goodLossProb = 0;
+    double badLossProb = 1;
+    double randomDuplicationProb = 0;
+    double reorderProb = 0;
+    int errorRng = 0;
+
+    // Where the receiver delivers the accepted payloads: a file, ":memory:", or nowhere if empty.
+    std::string deliveryOutput;
+};
+
+// Sets the parameter of `config` with the given NED name from its text value,
+// returning false if there is none.
+bool SetLinkParameter(LinkConfig &config, const std::string &name, const char* value);
+
+// A read-only input file mapped into memory, with its line index built once.
+// It is never modified after construction, so it can be shared between any number
+// of TextFile readers, including those of simulation runs on other threads.
+// Lines are indexed and read exactly as TextFile does from disk.
+class MappedInput {
+    std::string fileName;
+    const char* data = NULL;
+    size_t size = 0;
+    bool mapped = false;
+
+    // The file contents, where it is not mapped.
+    std::string contents;
 public:
-    Info() = delete;
-
-    // All the parameters set in the Newtork.
-    static int windowSize;
-    static double timeout;
-    static double processingTime;
-    static double transmissionDelay;
-    static double errorDelay;
-    static double duplicationDelay;
-    static double ackLossProb;
-
-    // The log file shared between sender and receiver `output.txt`
-    static std::ofstream log;
+    // Offsets of the line beginnings, as in TextFile::lineBeginnings.
+    std::vector<int64_t> lineBeginnings;
+
+    MappedInput(std::string fileName);
+    MappedInput(const MappedInput&) = delete;
+    MappedInput& operator=(const MappedInput&) = delete;
+    ~MappedInput();
+
+    int LineCount() const { return (int)lineBeginnings.size() - 1; }
+
+    // Reads the Nth line into `s`, reusing its storage. N must be less than LineCount().
+    void ReadLine(int N, std::string &s) const;
 };
 
+class LinePrefetcher;
+
 // Based on: https://stackoverflow.com/a/7273804
 class TextFile {
     std::string fileName;
     std::ifstream file_stream;
     linkedList<TextLine> bufferedLines;
+
+    // The buffered lines by number. The list keeps them in the order they were read, which
+    // is the order they are evicted in, and is out of line order after a rewind.
+    std::map<int, TextLine*> bufferedIndex;
+
+    // The shared input the lines are read from instead of the file, if any.
+    std::shared_ptr<const MappedInput> mappedInput;
+
+    // Reads the lines after the buffered ones ahead on a worker thread, if started.
+    std::unique_ptr<LinePrefetcher> prefetcher;
+
+    int LineCount() const;
+    void ReadLineFromSource(int N, std::string &s, bool &positioned);
+
+    // Appends an entry for the Nth line to the buffer, evicting the oldest line if it is full.
+    TextLine* BufferLine(int N);
+
+    // Drops the oldest buffered line.
+    void EvictOldestLine();
 public:
     std::vector<std::ifstream::streampos> lineBeginnings;
     TextFile();
     TextFile(std::string fileName);
+
+    // Reads the lines from `input`; OpenFile() then has nothing left to do.
+    TextFile(std::shared_ptr<const MappedInput> input);
     TextFile(TextFile&& b);
     ReadLineResult ReadNthLine(int N, std::string &s);
+
+    // Reads up to `count` consecutive lines starting from the Nth line into `lines`, reusing its
+    // strings, and whether each was read from the buffered lines into `readFromBuffer`. The lines
+    // are stored from index `offset` on, after any lines read before.
+    // Lines missing from the buffer are read from disk with a single seek.
+    // Returns the number of lines read, fewer than `count` when the file ends.
+    int ReadLines(int N, int count, std::vector<std::string> &lines, std::vector<bool> &readFromBuffer, int offset = 0);
     void SetBufferSize(int bufferSize);
     void OpenFile();
+
+    // Starts reading up to `lines` lines ahead, from the line after the last buffered one,
+    // on a worker thread (see LinePrefetcher), so that lines missing from the buffer are
+    // mostly found read already. Only for inputs read from disk, once opened.
+    void StartPrefetch(int lines);
+
+    // The lines read from disk that were found read ahead, and those that were not.
+    long PrefetchHits() const;
+    long PrefetchMisses() const;
+
+    // The numbers of the buffered lines, oldest first, and reading them back into the
+    // buffer in that order, so that a resumed run finds the same lines buffered.
+    std::vector<int> BufferedLines() const;
+    void RestoreBufferedLines(std::vector<int> const& lines);
+    int BufferedLineCount() const;
     virtual ~TextFile();
 };
 
@@ -92,6 +246,17 @@ public:
 vecBitset8 ConvertStringToBits(std::string const& message, bool frame = false);
 std::string ConvertBitsToString(vecBitset8 const& bytes, bool deframe = false);
 
+// Converts `length` characters of `message` into `bytes`, replacing its contents
+// but reusing its storage.
+void ConvertStringToBits(const char* message, size_t length, vecBitset8 &bytes, bool frame = false);
+
+// Sub-records of an aggregated frame: the decimal length of the record, ':' and the record.
+// SubRecordSize is the size of the sub-record of a `length` byte record. NextSubRecord reads
+// the sub-record at `offset` into `record` and moves past it, or returns false if it is malformed.
+size_t SubRecordSize(size_t length);
+void AppendSubRecord(std::string &packet, const char* record, size_t length);
+bool NextSubRecord(std::string const& packet, size_t &offset, std::string &record);
+
 // Calculation and verification of checksums.
 bool VerifyChecksum(vecBitset8 const &bytes, bitset8 const& checksum);
 bitset8 CalculateChecksum(vecBitset8 const &bytes);
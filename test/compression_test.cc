@@ -0,0 +1,113 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+// Round trips of payloads through the LZ77 PayloadCodec, with the sender and the receiver
+// each holding a codec of their own as in a run, so that the hash table of the sender
+// carries over from one payload to the next.
+
+#include <random>
+#include <string>
+#include "compression.h"
+#include "testing.h"
+
+static PayloadCodec sender, receiver;
+
+// Compresses the payload, checks that it decompresses back and returns its compressed size.
+static size_t RoundTrip(const std::string &payload) {
+    std::string compressed, decompressed;
+    sender.compress(payload.data(), payload.size(), compressed);
+    CHECK(compressed.find('\0') == std::string::npos || payload.find('\0') != std::string::npos);
+    CHECK(receiver.decompress(compressed, decompressed));
+    CHECK(decompressed == payload);
+    return compressed.size();
+}
+
+static void TestEmpty() {
+    CHECK(RoundTrip("") == 0);
+}
+
+static void TestSingleBytes() {
+    // Every byte value alone, the marker and NUL among them.
+    for (int c = 0; c < 256; c++) {
+        size_t size = RoundTrip(std::string(1, char(c)));
+        CHECK(size == (c == 0xff ? 2u : 1u));
+    }
+
+    // Strings too short for a match.
+    RoundTrip("abcd");
+    RoundTrip("\xff\xff\xff\xff");
+}
+
+static void TestLongRuns() {
+    // Runs longer than the longest match take several matches.
+    for (size_t length : {5, 6, 100, 65536, 65541, 200000}) {
+        size_t size = RoundTrip(std::string(length, 'a'));
+        if (length >= 100) CHECK(size < length / 100 + 16);
+    }
+    RoundTrip(std::string(70000, '\xff'));
+}
+
+static void TestIncompressible() {
+    // Random bytes, with the marker escaped wherever it occurs.
+    std::mt19937 rng(1);
+    for (size_t length : {7, 64, 4096, 100000}) {
+        std::string payload(length, '\0');
+        for (char &c : payload) c = char(rng());
+        size_t markers = 0;
+        for (char c : payload) markers += (unsigned char)c == 0xff;
+        CHECK(RoundTrip(payload) <= length + markers);
+    }
+}
+
+static void TestOverlappingMatches() {
+    // Repeats of a period shorter than the match, which the decoder copies from the
+    // bytes the match itself produces.
+    for (size_t period = 1; period <= 8; period++) {
+        std::string payload;
+        for (size_t i = 0; i < 1000; i++) payload += char('a' + i % period);
+        CHECK(RoundTrip(payload) < 32);
+    }
+
+    // Matches in text, at distances across earlier matches.
+    std::string line = "At time [1.500], Node [0] [sent] frame with seq_num = [3]; ";
+    std::string text;
+    for (int i = 0; i < 20; i++) text += line + std::to_string(i);
+    CHECK(RoundTrip(text) < text.size() / 4);
+    RoundTrip("xyzxyzxyzxyz\xffxyzxyzxyzxyz\xff");
+}
+
+static void TestMalformed() {
+    std::string out;
+    PayloadCodec codec;
+    CHECK(!codec.decompress("a\xff", out));
+    CHECK(!codec.decompress("a\xff\x00", out));
+    CHECK(!codec.decompress("a\xff\x02\x02", out));
+    CHECK(!codec.decompress(std::string("\xff\x02\x01", 3), out));
+    CHECK(codec.decompressionErrors == 4);
+}
+
+int main() {
+    TestEmpty();
+    TestSingleBytes();
+    TestLongRuns();
+    TestIncompressible();
+    TestOverlappingMatches();
+    TestMalformed();
+
+    // Payloads after others, with the table of the sender full of earlier positions.
+    TestOverlappingMatches();
+    TestSingleBytes();
+    return TestResult("compression_test");
+}
@@ -0,0 +1,151 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+// The CalendarQueue of the headless engine against the EventHeap: the same events pushed
+// into both must come out of both in the same order, by time and then insertion order.
+// The events are cancelled as the engine cancels them, by clearing their frame, and the
+// queues grow and shrink through several resizes of the calendar.
+
+#include <cstddef>
+#include <deque>
+#include <random>
+#include <vector>
+#include "eventqueue.h"
+#include "testing.h"
+
+// Each event is pushed into both queues, as a copy of its own in each since the calendar
+// links its events through them; the copies share their frame, a stand-in pointer.
+struct Twin {
+    Event heap, calendar;
+};
+
+class Queues {
+    EventHeap heap;
+    CalendarQueue calendar;
+    std::deque<Twin> twins;
+    uint64_t order = 0;
+
+public:
+    double now = 0;
+    std::vector<Twin*> pending;
+
+    void push(double time) {
+        twins.emplace_back();
+        Twin &t = twins.back();
+        t.heap.time = t.calendar.time = time;
+        t.heap.order = t.calendar.order = order++;
+        t.heap.frame = t.calendar.frame = (Frame*)&t;
+        heap.push(&t.heap);
+        calendar.push(&t.calendar);
+        pending.push_back(&t);
+    }
+
+    void cancel(Twin* t) {
+        t->heap.frame = t->calendar.frame = NULL;
+    }
+
+    // Pops the next event from both and checks that they agree. Returns false once empty.
+    bool pop() {
+        CHECK(heap.size() == calendar.size());
+        CHECK(heap.empty() == calendar.empty());
+        if (heap.empty() || calendar.empty()) return false;
+
+        Event* top = calendar.top();
+        Event* h = heap.pop();
+        Event* c = calendar.pop();
+        CHECK(c == top);
+        CHECK(h->time == c->time);
+        CHECK(h->order == c->order);
+        CHECK(h->frame == c->frame);
+        CHECK(c->time >= now);
+        now = c->time;
+
+        Twin* t = (Twin*)((char*)h - offsetof(Twin, heap));
+        for (size_t i = 0; i < pending.size(); i++) {
+            if (pending[i] == t) {
+                pending[i] = pending.back();
+                pending.pop_back();
+                break;
+            }
+        }
+        return true;
+    }
+
+    size_t size() const { return heap.size(); }
+};
+
+static void TestTies() {
+    // Events at a few times only, pushed out of order, come out first in, first out.
+    Queues q;
+    std::mt19937 rng(1);
+    const double times[] = {1.0, 0.5, 2.0, 0.5, 1.0, 0.1 + 0.2, 0.3};
+    for (int i = 0; i < 1000; i++) q.push(times[rng() % 7]);
+    while (q.pop()) {}
+
+    // All at the same time, the width of the calendar left as it was.
+    for (int i = 0; i < 300; i++) q.push(5.0);
+    for (int i = 0; i < 100; i++) q.pop();
+    for (int i = 0; i < 300; i++) q.push(5.0);
+    while (q.pop()) {}
+}
+
+static void TestHold() {
+    // The events of a run: every event handled schedules another a processing time,
+    // a transmission delay or a timeout later, at times that often coincide, and
+    // timers are cancelled while pending.
+    Queues q;
+    std::mt19937 rng(2);
+    const double delays[] = {0, 0.5, 1.0, 1.0, 10.0, 0.001, 4.0};
+    for (int i = 0; i < 64; i++) q.push(delays[rng() % 7]);
+
+    for (int step = 0; step < 200000 && q.size(); step++) {
+        q.pop();
+        int pushes = rng() % 5 == 0 ? 2 : 1;
+        if (q.size() > 512) pushes = 0;
+        for (int k = 0; k < pushes; k++) q.push(q.now + delays[rng() % 7]);
+        if (rng() % 3 == 0 && !q.pending.empty()) q.cancel(q.pending[rng() % q.pending.size()]);
+    }
+    while (q.pop()) {}
+}
+
+static void TestResizes() {
+    // Growing to thousands of events and draining again resizes the calendar both ways,
+    // at spacings from rounding errors to far-future outliers a year of days away.
+    Queues q;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    for (double scale : {1e-3, 1.0, 1e6}) {
+        for (int round = 0; round < 3; round++) {
+            int n = 100 << (2 * round);
+            for (int i = 0; i < n; i++) {
+                double time = q.now + scale * uniform(rng);
+                if (i % 97 == 0) time = q.now + scale * 1e4;
+                if (i % 13 == 0) time = q.now + scale * 1e-12;
+                q.push(time);
+                if (i % 7 == 0 && !q.pending.empty()) q.cancel(q.pending[rng() % q.pending.size()]);
+                if (i % 3 == 0) q.pop();
+            }
+            while (q.size() > (size_t)n / 10) q.pop();
+        }
+    }
+    while (q.pop()) {}
+}
+
+int main() {
+    TestTies();
+    TestHold();
+    TestResizes();
+    return TestResult("eventqueue_test");
+}
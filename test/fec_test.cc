@@ -0,0 +1,121 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+// The SECDED code of fec.cc on random payloads of lengths around the block size, with
+// no errors, every single flipped bit and every two flipped bits of a block.
+
+#include <random>
+#include "fec.h"
+#include "testing.h"
+
+static const size_t LENGTHS[] = {0, 1, 7, 8, 9, 15, 16, 17, 31};
+
+static vecBitset8 RandomPayload(std::mt19937 &rng, size_t length) {
+    vecBitset8 payload(length);
+    for (bitset8 &b : payload) b = bitset8(rng());
+    return payload;
+}
+
+// The block of an encoded payload of `length` data bytes that the bit belongs to.
+static size_t BlockOf(size_t bit, size_t length) {
+    size_t byte = bit / 8;
+    return byte < length ? byte / 8 : byte - length;
+}
+
+static void TestNoErrors(std::mt19937 &rng) {
+    for (size_t length : LENGTHS) {
+        vecBitset8 data = RandomPayload(rng, length);
+        vecBitset8 payload = data;
+        FecEncode(payload);
+        CHECK(payload.size() == length + FecCheckBytes(length));
+        CHECK(FecDataBytes(payload.size()) == length);
+
+        FecResult result = FecDecode(payload);
+        CHECK(result.correctedBits == 0);
+        CHECK(!result.uncorrectable);
+        CHECK(payload == data);
+    }
+}
+
+static void TestSingleErrors(std::mt19937 &rng) {
+    // Any one bit, in the data or the check bytes, is corrected.
+    for (size_t length : LENGTHS) {
+        vecBitset8 data = RandomPayload(rng, length);
+        vecBitset8 encoded = data;
+        FecEncode(encoded);
+
+        for (size_t bit = 0; bit < encoded.size() * 8; bit++) {
+            vecBitset8 payload = encoded;
+            payload[bit / 8].flip(bit % 8);
+            FecResult result = FecDecode(payload);
+            CHECK(result.correctedBits == 1);
+            CHECK(!result.uncorrectable);
+            CHECK(payload == data);
+        }
+    }
+
+    // One bit in each block is corrected in each.
+    vecBitset8 data = RandomPayload(rng, 20);
+    vecBitset8 payload = data;
+    FecEncode(payload);
+    payload[3].flip(5);
+    payload[12].flip(0);
+    payload[22].flip(7);
+    FecResult result = FecDecode(payload);
+    CHECK(result.correctedBits == 3);
+    CHECK(!result.uncorrectable);
+    CHECK(payload == data);
+}
+
+static void TestDoubleErrors(std::mt19937 &rng) {
+    // Any two bits of the same block are detected, and not taken for a single error.
+    for (size_t length : LENGTHS) {
+        vecBitset8 encoded = RandomPayload(rng, length);
+        FecEncode(encoded);
+        size_t bits = encoded.size() * 8;
+
+        for (size_t first = 0; first < bits; first++) {
+            for (size_t second = first + 1; second < bits; second++) {
+                if (BlockOf(first, length) != BlockOf(second, length)) continue;
+                vecBitset8 payload = encoded;
+                payload[first / 8].flip(first % 8);
+                payload[second / 8].flip(second % 8);
+                FecResult result = FecDecode(payload);
+                CHECK(result.uncorrectable);
+                CHECK(result.correctedBits == 0);
+            }
+        }
+    }
+
+    // A double error in one block leaves a single error in another correctable.
+    vecBitset8 data = RandomPayload(rng, 16);
+    vecBitset8 payload = data;
+    FecEncode(payload);
+    payload[1].flip(2);
+    payload[6].flip(4);
+    payload[9].flip(1);
+    FecResult result = FecDecode(payload);
+    CHECK(result.uncorrectable);
+    CHECK(result.correctedBits == 1);
+    CHECK(payload[9] == data[9]);
+}
+
+int main() {
+    std::mt19937 rng(1);
+    TestNoErrors(rng);
+    TestSingleErrors(rng);
+    TestDoubleErrors(rng);
+    return TestResult("fec_test");
+}
@@ -0,0 +1,70 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+// The range checks of LinkConfig::Validate on the parameters of the link and channel models,
+// set by their NED names as the headless engine does.
+
+#include <stdexcept>
+#include <string>
+#include "util.h"
+#include "testing.h"
+
+// Validates a default configuration with the one parameter set, returning the error, if any.
+static std::string Validate(const char* name, const char* value) {
+    LinkConfig config;
+    CHECK(SetLinkParameter(config, name, value));
+    try {
+        config.Validate();
+    }
+    catch (std::runtime_error &e) {
+        return e.what();
+    }
+    return "";
+}
+
+// Checks that the value is accepted, or rejected with the name of the parameter.
+static void CheckValid(const char* name, const char* value) {
+    CHECK(Validate(name, value).empty());
+}
+
+static void CheckInvalid(const char* name, const char* value) {
+    std::string error = Validate(name, value);
+    CHECK(error.find(std::string(" ") + name + " ") != std::string::npos);
+}
+
+static void TestProbabilities() {
+    for (const char* name : {"LP", "BER", "GB", "BG", "LG", "LB", "DP", "RP"}) {
+        CheckValid(name, "0");
+        CheckValid(name, "0.5");
+        CheckValid(name, "1");
+        CheckInvalid(name, "-0.1");
+        CheckInvalid(name, "1.5");
+    }
+}
+
+static void TestNonNegative() {
+    for (const char* name : {"PD", "DR", "QL", "ER"}) {
+        CheckValid(name, "0");
+        CheckValid(name, "3");
+        CheckInvalid(name, "-1");
+    }
+}
+
+int main() {
+    CHECK(Validate("WS", "3").empty());
+    TestProbabilities();
+    TestNonNegative();
+    return TestResult("linkconfig_test");
+}
@@ -0,0 +1,41 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+#ifndef TESTING_H_
+#define TESTING_H_
+
+#include <stdio.h>
+
+// The checks of the unit tests. A failed check is reported with its place and the test
+// goes on, so that one run shows every failure; the test then exits with 1.
+
+static int checksFailed = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            checksFailed++; \
+        } \
+    } while (0)
+
+// Reports the outcome of the test and returns its exit status.
+static inline int TestResult(const char* name) {
+    if (checksFailed) fprintf(stderr, "FAIL    %s (%d checks failed)\n", name, checksFailed);
+    else printf("PASS    %s\n", name);
+    return checksFailed ? 1 : 0;
+}
+
+#endif /* TESTING_H_ */
@@ -0,0 +1,123 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// 
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+// 
+
+// Reads of the input lines through the line buffer of TextFile, as the sender does them:
+// aggregated frames of consecutive lines, and rewinds of the window to lines that have
+// already been evicted, which leave the buffer out of line order.
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "util.h"
+#include "testing.h"
+
+static const int LINES = 20;
+static const char* FILE_NAME = "textfile_test.txt";
+
+static std::string Line(int n) {
+    return "line " + std::to_string(n);
+}
+
+// The lines end with "\r\n", of which TextFile leaves out both characters.
+static void WriteInput() {
+    FILE* f = fopen(FILE_NAME, "wb");
+    for (int n = 0; n < LINES; n++) fprintf(f, "%s\r\n", Line(n).c_str());
+    fclose(f);
+}
+
+// Checks that no line is buffered twice and that the buffer holds at most `size` lines.
+static void CheckBuffer(TextFile &input, int size) {
+    std::vector<int> buffered = input.BufferedLines();
+    CHECK((int)buffered.size() == input.BufferedLineCount());
+    CHECK((int)buffered.size() <= size);
+    CHECK(std::set<int>(buffered.begin(), buffered.end()).size() == buffered.size());
+}
+
+// Reads an aggregated frame of `count` lines from the Nth and checks each of them.
+static void CheckFrame(TextFile &input, int N, int count, std::vector<bool> const& expectBuffered) {
+    std::vector<std::string> lines;
+    std::vector<bool> readFromBuffer;
+    CHECK(input.ReadLines(N, count, lines, readFromBuffer) == count);
+    for (int i = 0; i < count; i++) {
+        CHECK(lines[i] == Line(N + i));
+        CHECK(readFromBuffer[i] == expectBuffered[i]);
+    }
+}
+
+static void TestRewindAcrossFrame(TextFile &input) {
+    input.SetBufferSize(4);
+
+    // Two frames: lines 0 to 3, then 4 to 6, which evict 0 to 2.
+    CheckFrame(input, 0, 4, {false, false, false, false});
+    CheckFrame(input, 4, 3, {false, false, false});
+    CHECK(input.BufferedLines() == std::vector<int>({3, 4, 5, 6}));
+
+    // A rewind to line 1, read alone, goes after the newer lines.
+    std::string s;
+    ReadLineResult r = input.ReadNthLine(1, s);
+    CHECK(r.moreLinesToRead && !r.readFromBuffer && s == Line(1));
+    CHECK(input.BufferedLines() == std::vector<int>({4, 5, 6, 1}));
+    CheckBuffer(input, 4);
+
+    // An aggregated frame from line 1 finds it buffered although it is the newest line,
+    // and each of the lines after it read once.
+    CheckFrame(input, 1, 3, {true, false, false});
+    CHECK(input.BufferedLines() == std::vector<int>({6, 1, 2, 3}));
+    CheckBuffer(input, 4);
+
+    // A frame across the rewound lines and the ones after, with 6 now the oldest.
+    CheckFrame(input, 2, 6, {true, true, false, false, false, false});
+    CheckBuffer(input, 4);
+    CHECK(input.BufferedLines() == std::vector<int>({4, 5, 6, 7}));
+
+    r = input.ReadNthLine(5, s);
+    CHECK(r.moreLinesToRead && r.readFromBuffer && s == Line(5));
+}
+
+static void TestRestore(TextFile &input) {
+    // The buffer of a resumed run, out of line order, and a frame across it.
+    input.SetBufferSize(4);
+    input.RestoreBufferedLines({9, 10, 2, 3});
+    CHECK(input.BufferedLines() == std::vector<int>({9, 10, 2, 3}));
+    CheckFrame(input, 2, 3, {true, true, false});
+    CHECK(input.BufferedLines() == std::vector<int>({10, 2, 3, 4}));
+    CheckFrame(input, 10, 2, {true, false});
+    CHECK(input.BufferedLines() == std::vector<int>({2, 3, 4, 11}));
+    CheckBuffer(input, 4);
+}
+
+int main() {
+    WriteInput();
+    {
+        TextFile input(FILE_NAME);
+        input.OpenFile();
+        TestRewindAcrossFrame(input);
+    }
+    {
+        TextFile input(std::make_shared<const MappedInput>(FILE_NAME));
+        input.OpenFile();
+        TestRewindAcrossFrame(input);
+    }
+    {
+        TextFile input(FILE_NAME);
+        input.OpenFile();
+        TestRestore(input);
+    }
+    remove(FILE_NAME);
+    return TestResult("textfile_test");
+}